@@ -0,0 +1,120 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#define BATCH_CHUNK_SIZE 4096
+
+// Default number of workers for a batch run.
+inline unsigned default_thread_count() {
+    const unsigned hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : hardware;
+}
+
+// Accepts / rejects batches of inputs and writes one verdict line per
+// input, in input order. Inputs are split into chunks of BATCH_CHUNK_SIZE
+// strings. Each worker starts on its own contiguous block of chunks and
+// steals chunks from the other blocks once its own is used up. The calling
+// thread writes finished chunks to `out` in order as soon as they are ready.
+//
+// Matcher must have a `bool accepts(std::string_view)` member. There is one
+// matcher per worker, created up front and kept across batches, so matchers
+// may keep mutable scratch state or caches that warm up over a whole run.
+template<typename Matcher>
+class BatchRunner {
+public:
+    template<typename MakeMatcher>
+    explicit BatchRunner(MakeMatcher make_matcher, unsigned thread_count = default_thread_count()) {
+        for (unsigned i = 0; i < std::max(1u, thread_count); ++i) {
+            matchers.push_back(make_matcher());
+        }
+    }
+
+    void run(const std::vector<std::string_view> &inputs, std::ostream &out) {
+        const size_t chunks = (inputs.size() + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+        const size_t workers = std::max<size_t>(1, std::min(matchers.size(), chunks));
+
+        auto evaluate_chunk = [&inputs](Matcher &matcher, size_t chunk, std::string &buffer) {
+            const size_t first = chunk * BATCH_CHUNK_SIZE;
+            const size_t last = std::min(inputs.size(), first + BATCH_CHUNK_SIZE);
+            buffer.clear();
+            buffer.reserve((last - first) * 7);
+            for (size_t i = first; i < last; ++i) {
+                buffer += matcher.accepts(inputs[i]) ? "accept\n" : "reject\n";
+            }
+        };
+
+        if (workers == 1) {
+            std::string buffer{};
+            for (size_t chunk = 0; chunk < chunks; ++chunk) {
+                evaluate_chunk(matchers[0], chunk, buffer);
+                out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            }
+            return;
+        }
+
+        struct ChunkBlock {
+            std::atomic<size_t> next{0};
+            size_t end{0};
+        };
+        std::unique_ptr<ChunkBlock[]> blocks{new ChunkBlock[workers]};
+        for (size_t w = 0; w < workers; ++w) {
+            blocks[w].next = w * chunks / workers;
+            blocks[w].end = (w + 1) * chunks / workers;
+        }
+
+        std::vector<std::string> results(chunks);
+        std::unique_ptr<std::atomic<bool>[]> ready{new std::atomic<bool>[chunks]};
+        for (size_t i = 0; i < chunks; ++i) {
+            ready[i] = false;
+        }
+        std::mutex ready_mutex;
+        std::condition_variable ready_signal;
+
+        auto worker = [&](size_t id) {
+            for (size_t offset = 0; offset < workers; ++offset) {
+                ChunkBlock &block = blocks[(id + offset) % workers];
+                for (size_t chunk = block.next++; chunk < block.end; chunk = block.next++) {
+                    evaluate_chunk(matchers[id], chunk, results[chunk]);
+                    {
+                        std::lock_guard<std::mutex> lock{ready_mutex};
+                        ready[chunk] = true;
+                    }
+                    ready_signal.notify_one();
+                }
+            }
+        };
+
+        std::vector<std::thread> threads{};
+        for (size_t w = 0; w < workers; ++w) {
+            threads.emplace_back(worker, w);
+        }
+
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            if (!ready[chunk]) {
+                std::unique_lock<std::mutex> lock{ready_mutex};
+                ready_signal.wait(lock, [&] { return ready[chunk].load(); });
+            }
+            out.write(results[chunk].data(), static_cast<std::streamsize>(results[chunk].size()));
+            std::string{}.swap(results[chunk]);
+        }
+
+        for (std::thread &t: threads) {
+            t.join();
+        }
+    }
+
+private:
+    std::vector<Matcher> matchers{};
+};
+
+#endif
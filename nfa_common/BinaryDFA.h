@@ -0,0 +1,210 @@
+#ifndef BINARY_DFA_H
+#define BINARY_DFA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary DFA file, laid out so it can be memory mapped and used in place:
+//
+//   BinaryDFAHeader
+//   uint32_t symbol_of_byte[256]   dense symbol id per input byte, or
+//                                  BINARY_DFA_NO_SYMBOL
+//   uint32_t transitions[states * symbols]
+//                                  target of (state, symbol) at
+//                                  state * symbols + symbol
+//   uint64_t accept[(states + 63) / 64]
+//                                  bit s set when state s accepts
+//
+// All integers use the byte order of the machine that wrote the file, and
+// every section starts on an 8 byte boundary.
+#define BINARY_DFA_MAGIC "TOCDFA\r\n"
+#define BINARY_DFA_VERSION 1
+#define BINARY_DFA_NO_SYMBOL UINT32_MAX
+
+struct BinaryDFAHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t states;
+  uint32_t symbols;
+  uint32_t start;
+  uint64_t transitions_offset;
+  uint64_t accept_offset;
+  uint64_t file_size;
+};
+
+inline uint64_t align_to_8(uint64_t offset) { return (offset + 7) & ~uint64_t{7}; }
+
+// Write a complete DFA with single character symbols. symbol_names[i] is the
+// symbol with id i, transitions[state * symbols + symbol] the target. Returns
+// an empty string on success, otherwise a description of what went wrong.
+inline std::string write_binary_dfa(const std::string &path, int states,
+                                    const std::vector<std::string> &symbol_names,
+                                    const std::vector<int> &transitions,
+                                    const std::vector<bool> &accept) {
+  const uint32_t symbols{static_cast<uint32_t>(symbol_names.size())};
+  uint32_t symbol_of_byte[256];
+  std::fill(std::begin(symbol_of_byte), std::end(symbol_of_byte), BINARY_DFA_NO_SYMBOL);
+  for (uint32_t i = 0; i < symbols; ++i) {
+    if (symbol_names[i].size() != 1) {
+      return "symbol '" + symbol_names[i] + "' is not a single character";
+    }
+    symbol_of_byte[static_cast<unsigned char>(symbol_names[i][0])] = i;
+  }
+
+  BinaryDFAHeader header{};
+  std::memcpy(header.magic, BINARY_DFA_MAGIC, sizeof(header.magic));
+  header.version = BINARY_DFA_VERSION;
+  header.states = static_cast<uint32_t>(states);
+  header.symbols = symbols;
+  header.start = 0;
+  header.transitions_offset = align_to_8(sizeof(header) + sizeof(symbol_of_byte));
+  header.accept_offset = align_to_8(header.transitions_offset +
+                                    uint64_t{header.states} * symbols * sizeof(uint32_t));
+  const uint64_t accept_words{(uint64_t{header.states} + 63) / 64};
+  header.file_size = header.accept_offset + accept_words * sizeof(uint64_t);
+
+  std::vector<char> image(header.file_size, 0);
+  std::memcpy(image.data(), &header, sizeof(header));
+  std::memcpy(image.data() + sizeof(header), symbol_of_byte, sizeof(symbol_of_byte));
+  auto *table = reinterpret_cast<uint32_t *>(image.data() + header.transitions_offset);
+  for (size_t i = 0; i < transitions.size(); ++i) {
+    table[i] = static_cast<uint32_t>(transitions[i]);
+  }
+  auto *accept_bits = reinterpret_cast<uint64_t *>(image.data() + header.accept_offset);
+  for (uint32_t s = 0; s < header.states; ++s) {
+    if (accept[s]) accept_bits[s / 64] |= uint64_t{1} << (s % 64);
+  }
+
+  FILE *file = std::fopen(path.c_str(), "wb");
+  if (!file) {
+    return "cannot open " + path + " for writing";
+  }
+  const bool written{std::fwrite(image.data(), 1, image.size(), file) == image.size()};
+  if (std::fclose(file) != 0 || !written) {
+    return "failed writing " + path;
+  }
+  return "";
+}
+
+// Read-only view of a binary DFA file mapped into memory. Nothing is parsed
+// or copied: lookups go straight to the mapped tables. Loading checks the
+// header, the section bounds and every symbol id and transition target, so
+// a corrupt file is rejected instead of sending a lookup out of bounds; that
+// is one read over the mapped tables.
+class MappedDFA {
+public:
+  explicit MappedDFA(const std::string &path) {
+    const int fd{open(path.c_str(), O_RDONLY)};
+    if (fd < 0) {
+      load_error = "cannot open " + path;
+      return;
+    }
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(BinaryDFAHeader)) {
+      close(fd);
+      load_error = path + " is too small to be a binary DFA";
+      return;
+    }
+    void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      load_error = "cannot map " + path;
+      return;
+    }
+    base = static_cast<const char *>(mapping);
+    size = static_cast<size_t>(info.st_size);
+    validate(path);
+  }
+
+  MappedDFA(const MappedDFA &) = delete;
+
+  MappedDFA &operator=(const MappedDFA &) = delete;
+
+  ~MappedDFA() {
+    if (base) munmap(const_cast<char *>(base), size);
+  }
+
+  // Empty when the file was mapped and passed validation.
+  [[nodiscard]] const std::string &error() const { return load_error; }
+
+  [[nodiscard]] uint32_t state_count() const { return header->states; }
+
+  [[nodiscard]] bool accepts(std::string_view input) const {
+    uint32_t state{header->start};
+    for (const char c : input) {
+      const uint32_t symbol{symbol_of_byte[static_cast<unsigned char>(c)]};
+      if (symbol == BINARY_DFA_NO_SYMBOL) {
+        return false;
+      }
+      state = transitions[static_cast<size_t>(state) * header->symbols + symbol];
+    }
+    return (accept[state / 64] >> (state % 64)) & 1;
+  }
+
+private:
+  const char *base{nullptr};
+  size_t size{0};
+  std::string load_error{};
+  const BinaryDFAHeader *header{nullptr};
+  const uint32_t *symbol_of_byte{nullptr};
+  const uint32_t *transitions{nullptr};
+  const uint64_t *accept{nullptr};
+
+  void validate(const std::string &path) {
+    header = reinterpret_cast<const BinaryDFAHeader *>(base);
+    if (std::memcmp(header->magic, BINARY_DFA_MAGIC, sizeof(header->magic)) != 0) {
+      load_error = path + " is not a binary DFA";
+      return;
+    }
+    if (header->version != BINARY_DFA_VERSION) {
+      load_error = path + " has unsupported version " + std::to_string(header->version);
+      return;
+    }
+    // Every bound is checked as a difference against offsets already known
+    // to lie inside the file, so no sum can wrap around. states * symbols
+    // fits in 64 bits, and limiting it to size / 4 keeps table_bytes exact.
+    const uint64_t cells{uint64_t{header->states} * header->symbols};
+    const uint64_t table_bytes{cells * sizeof(uint32_t)};
+    const uint64_t accept_bytes{(uint64_t{header->states} + 63) / 64 * sizeof(uint64_t)};
+    if (header->file_size != size || header->states == 0 || header->start >= header->states ||
+        header->transitions_offset < sizeof(BinaryDFAHeader) + 256 * sizeof(uint32_t) ||
+        header->transitions_offset % 8 != 0 || header->accept_offset % 8 != 0 ||
+        header->transitions_offset > header->accept_offset || header->accept_offset > size ||
+        cells > size / sizeof(uint32_t) ||
+        table_bytes > header->accept_offset - header->transitions_offset ||
+        accept_bytes > size - header->accept_offset) {
+      load_error = path + " is truncated or has an inconsistent header";
+      return;
+    }
+
+    symbol_of_byte = reinterpret_cast<const uint32_t *>(base + sizeof(BinaryDFAHeader));
+    transitions = reinterpret_cast<const uint32_t *>(base + header->transitions_offset);
+    accept = reinterpret_cast<const uint64_t *>(base + header->accept_offset);
+
+    for (int b = 0; b < 256; ++b) {
+      if (symbol_of_byte[b] != BINARY_DFA_NO_SYMBOL && symbol_of_byte[b] >= header->symbols) {
+        load_error = path + " maps byte " + std::to_string(b) + " to a symbol out of range";
+        return;
+      }
+    }
+    for (uint64_t i = 0; i < cells; ++i) {
+      if (transitions[i] >= header->states) {
+        load_error = path + " has a transition to a state out of range";
+        return;
+      }
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef EPSILON_CLOSURES_H
+#define EPSILON_CLOSURES_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Epsilon closure of every state at once. epsilon_edges[s] lists the targets
+// of the epsilon transitions out of s. On return the closure of s, sorted and
+// including s itself, is closure_targets[closure_offsets[s], closure_offsets[s + 1]).
+//
+// States on an epsilon cycle all share one closure, so the epsilon graph is
+// first condensed into its strongly connected components (Tarjan). Tarjan
+// finishes a component only after every component it reaches, so walking the
+// components in finishing order means each closure is the component's own
+// states plus the already known closures of its successor components. A
+// generation stamp per state drops duplicates while merging, which keeps
+// memory proportional to the closure sizes rather than states squared.
+inline void compute_epsilon_closures(int states, const std::vector<std::vector<int>> &epsilon_edges,
+                                     std::vector<int> &closure_offsets, std::vector<int> &closure_targets) {
+    // Iterative Tarjan; component ids are handed out in finishing order
+    std::vector<int> index(states, -1);
+    std::vector<int> low(states, 0);
+    std::vector<int> component(states, -1);
+    std::vector<int> tarjan_stack{};
+    std::vector<std::pair<int, size_t>> call_stack{};
+    int next_index{0};
+    int components{0};
+    for (int root = 0; root < states; ++root) {
+        if (index[root] != -1) continue;
+        call_stack.emplace_back(root, 0);
+        index[root] = low[root] = next_index++;
+        tarjan_stack.push_back(root);
+
+        while (!call_stack.empty()) {
+            auto &[s, edge] = call_stack.back();
+            if (edge < epsilon_edges[s].size()) {
+                const int to{epsilon_edges[s][edge++]};
+                if (index[to] == -1) {
+                    index[to] = low[to] = next_index++;
+                    tarjan_stack.push_back(to);
+                    call_stack.emplace_back(to, 0);
+                } else if (component[to] == -1) {
+                    low[s] = std::min(low[s], index[to]);
+                }
+                continue;
+            }
+
+            const int finished{s};
+            call_stack.pop_back();
+            if (!call_stack.empty()) {
+                const int parent{call_stack.back().first};
+                low[parent] = std::min(low[parent], low[finished]);
+            }
+            if (low[finished] == index[finished]) {
+                int member;
+                do {
+                    member = tarjan_stack.back();
+                    tarjan_stack.pop_back();
+                    component[member] = components;
+                } while (member != finished);
+                ++components;
+            }
+        }
+    }
+
+    // States of every component, grouped
+    std::vector<int> member_offsets(components + 1, 0);
+    for (int s = 0; s < states; ++s) {
+        ++member_offsets[component[s] + 1];
+    }
+    for (int c = 0; c < components; ++c) {
+        member_offsets[c + 1] += member_offsets[c];
+    }
+    std::vector<int> members(states);
+    {
+        std::vector<int> fill(member_offsets.begin(), member_offsets.end() - 1);
+        for (int s = 0; s < states; ++s) {
+            members[fill[component[s]]++] = s;
+        }
+    }
+
+    // Closures per component, successors first
+    std::vector<int> component_offsets{0};
+    std::vector<int> component_targets{};
+    std::vector<int> state_seen(states, -1);
+    std::vector<int> component_seen(components, -1);
+    for (int c = 0; c < components; ++c) {
+        const size_t first = component_targets.size();
+        for (int m = member_offsets[c]; m < member_offsets[c + 1]; ++m) {
+            state_seen[members[m]] = c;
+            component_targets.push_back(members[m]);
+        }
+        component_seen[c] = c;
+        for (int m = member_offsets[c]; m < member_offsets[c + 1]; ++m) {
+            for (const int to: epsilon_edges[members[m]]) {
+                const int d{component[to]};
+                if (component_seen[d] == c) continue;
+                component_seen[d] = c;
+                for (int i = component_offsets[d]; i < component_offsets[d + 1]; ++i) {
+                    const int s{component_targets[i]};
+                    if (state_seen[s] != c) {
+                        state_seen[s] = c;
+                        component_targets.push_back(s);
+                    }
+                }
+            }
+        }
+        std::sort(component_targets.begin() + static_cast<long>(first), component_targets.end());
+        component_offsets.push_back(static_cast<int>(component_targets.size()));
+    }
+
+    closure_offsets.assign(1, 0);
+    closure_targets.clear();
+    for (int s = 0; s < states; ++s) {
+        const int c{component[s]};
+        closure_targets.insert(closure_targets.end(), component_targets.begin() + component_offsets[c],
+                               component_targets.begin() + component_offsets[c + 1]);
+        closure_offsets.push_back(static_cast<int>(closure_targets.size()));
+    }
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef ANTICHAIN_CHECKS_H
+#define ANTICHAIN_CHECKS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+// NFA over a fixed, shared list of symbols. State sets are bitsets, but the
+// successors of each (state, symbol) are a sorted list of states, so memory
+// follows the transitions rather than states^2 * symbols. Successors are
+// added with add_successor and become visible after finish().
+// successors(state, symbol) and start are already epsilon closed.
+struct BitNFA {
+  struct StateRange {
+    const int *first;
+    const int *last;
+
+    [[nodiscard]] const int *begin() const { return first; }
+    [[nodiscard]] const int *end() const { return last; }
+  };
+
+  int states{};
+  int symbols{};
+  size_t words{};
+  std::vector<uint64_t> start{};
+  std::vector<uint64_t> accept{};
+
+  BitNFA(int states, int symbols)
+      : states{states}, symbols{symbols},
+        words{static_cast<size_t>((states + 63) / 64)},
+        start(words, 0), accept(words, 0) {}
+
+  void add_successor(int state, int symbol, int to) {
+    pending.push_back({cell(state, symbol), to});
+  }
+
+  // Group the added successors by (state, symbol) into the CSR arrays,
+  // dropping duplicates.
+  void finish() {
+    std::sort(pending.begin(), pending.end());
+    pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+    offsets.assign(static_cast<size_t>(states) * symbols + 1, 0);
+    targets.clear();
+    targets.reserve(pending.size());
+    for (const auto &[c, to] : pending) {
+      ++offsets[c + 1];
+      targets.push_back(to);
+    }
+    for (size_t c = 1; c < offsets.size(); ++c) {
+      offsets[c] += offsets[c - 1];
+    }
+    pending.clear();
+    pending.shrink_to_fit();
+  }
+
+  [[nodiscard]] StateRange successors(int state, int symbol) const {
+    const size_t c{cell(state, symbol)};
+    return {targets.data() + offsets[c], targets.data() + offsets[c + 1]};
+  }
+
+  static void set_bit(uint64_t *set, int bit) {
+    set[bit / 64] |= uint64_t{1} << (bit % 64);
+  }
+
+  [[nodiscard]] static bool test_bit(const uint64_t *set, int bit) {
+    return (set[bit / 64] >> (bit % 64)) & 1;
+  }
+
+  // Automaton with one accepting state that loops on every symbol.
+  static BitNFA universal(int symbols) {
+    BitNFA all{1, symbols};
+    set_bit(all.start.data(), 0);
+    set_bit(all.accept.data(), 0);
+    for (int a = 0; a < symbols; ++a) {
+      all.add_successor(0, a, 0);
+    }
+    all.finish();
+    return all;
+  }
+
+private:
+  std::vector<std::pair<size_t, int>> pending{};
+  std::vector<size_t> offsets{};
+  std::vector<int> targets{};
+
+  [[nodiscard]] size_t cell(int state, int symbol) const {
+    return static_cast<size_t>(state) * symbols + symbol;
+  }
+};
+
+// Outcome of a language check. When it fails, counterexample holds the
+// symbol ids of a word that shows it.
+struct CheckResult {
+  bool holds{true};
+  std::vector<int> counterexample{};
+};
+
+// Decide L(a) ⊆ L(b) without determinising b, using the antichain
+// algorithm of De Wulf, Doyen, Henzinger and Raskin. The search runs over
+// pairs (p, S) of a state of a and the set of states b can be in after the
+// same word, looking for an accepting p with no accepting state in S. A pair
+// (p, S) is dropped when a pair (p, S') with S' ⊆ S has been seen: any word
+// that leads from (p, S) to a counterexample also does so from (p, S'). Only
+// the subset-minimal sets per state of a are kept, which on typical inputs is
+// far fewer than the reachable subsets of b.
+inline CheckResult check_inclusion(const BitNFA &a, const BitNFA &b) {
+  struct Node {
+    int state;
+    std::vector<uint64_t> set;
+    int parent;
+    int symbol;
+    bool subsumed;
+  };
+
+  const size_t words{b.words};
+  std::vector<Node> nodes{};
+  std::vector<std::vector<int>> antichain(a.states);
+  std::deque<int> queue{};
+
+  auto is_subset = [words](const std::vector<uint64_t> &small,
+                           const std::vector<uint64_t> &large) {
+    for (size_t i = 0; i < words; ++i) {
+      if (small[i] & ~large[i]) return false;
+    }
+    return true;
+  };
+  auto rejects = [&b, words](const std::vector<uint64_t> &set) {
+    for (size_t i = 0; i < words; ++i) {
+      if (set[i] & b.accept[i]) return false;
+    }
+    return true;
+  };
+  auto counterexample = [&nodes](int node) {
+    CheckResult result{false, {}};
+    for (int n = node; nodes[n].parent != -1; n = nodes[n].parent) {
+      result.counterexample.insert(result.counterexample.begin(), nodes[n].symbol);
+    }
+    return result;
+  };
+
+  // Returns the new node id, or -1 if (state, set) is subsumed
+  auto insert = [&](int state, std::vector<uint64_t> set, int parent,
+                    int symbol) {
+    std::vector<int> &minimal = antichain[state];
+    for (const int id : minimal) {
+      if (is_subset(nodes[id].set, set)) return -1;
+    }
+    size_t kept{0};
+    for (const int id : minimal) {
+      if (is_subset(set, nodes[id].set)) {
+        nodes[id].subsumed = true;
+      } else {
+        minimal[kept++] = id;
+      }
+    }
+    minimal.resize(kept);
+
+    const int id{static_cast<int>(nodes.size())};
+    nodes.push_back({state, std::move(set), parent, symbol, false});
+    minimal.push_back(id);
+    queue.push_back(id);
+    return id;
+  };
+
+  for (int p = 0; p < a.states; ++p) {
+    if (!BitNFA::test_bit(a.start.data(), p)) continue;
+    const int id{insert(p, b.start, -1, -1)};
+    if (id != -1 && BitNFA::test_bit(a.accept.data(), p) && rejects(nodes[id].set)) {
+      return counterexample(id);
+    }
+  }
+
+  std::vector<uint64_t> next(words);
+  while (!queue.empty()) {
+    const int current{queue.front()};
+    queue.pop_front();
+    if (nodes[current].subsumed) continue;
+
+    for (int symbol = 0; symbol < a.symbols; ++symbol) {
+      // Post image of the b set, visiting only the states in it
+      std::fill(next.begin(), next.end(), 0);
+      for (size_t w = 0; w < words; ++w) {
+        uint64_t bits{nodes[current].set[w]};
+        while (bits) {
+          const int q{static_cast<int>(w * 64) + __builtin_ctzll(bits)};
+          bits &= bits - 1;
+          for (const int to : b.successors(q, symbol)) {
+            BitNFA::set_bit(next.data(), to);
+          }
+        }
+      }
+
+      for (const int p : a.successors(nodes[current].state, symbol)) {
+        const int id{insert(p, next, current, symbol)};
+        if (id != -1 && BitNFA::test_bit(a.accept.data(), p) && rejects(next)) {
+          return counterexample(id);
+        }
+      }
+    }
+  }
+
+  return {};
+}
+
+// L(n) = Σ* over the symbols of n.
+inline CheckResult check_universality(const BitNFA &n) {
+  return check_inclusion(BitNFA::universal(n.symbols), n);
+}
+
+// L(a) = L(b), checked as inclusion both ways.
+inline CheckResult check_equivalence(const BitNFA &a, const BitNFA &b) {
+  CheckResult forward{check_inclusion(a, b)};
+  if (!forward.holds) return forward;
+  return check_inclusion(b, a);
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef DENSE_DFA_H
+#define DENSE_DFA_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// A complete DFA stored as a dense transition matrix. State 0 is the start
+// state and transitions[state * symbols + symbol] is the target state.
+struct DenseDFA {
+  int states{};
+  int symbols{};
+  std::vector<int> transitions{};
+  std::vector<bool> accept{};
+
+  [[nodiscard]] int next(int state, int symbol) const {
+    return transitions[static_cast<size_t>(state) * symbols + symbol];
+  }
+};
+
+// Hopcroft's partition refinement. Blocks are kept as contiguous ranges of
+// one permutation of the states so splitting a block only swaps elements,
+// and after a split only the smaller half is queued as a new splitter for
+// symbols the block was not already queued for, giving O(n k log n).
+//
+// Returns the minimal DFA, with states numbered in breadth first order from
+// the start state so the output is deterministic.
+inline DenseDFA minimize(const DenseDFA &dfa) {
+  const int n{dfa.states};
+  const int k{dfa.symbols};
+  if (n == 0) return dfa;
+
+  // Predecessors of every state per symbol, in CSR form
+  std::vector<int> predecessor_start(static_cast<size_t>(n) * k + 1, 0);
+  for (int s = 0; s < n; ++s) {
+    for (int a = 0; a < k; ++a) {
+      ++predecessor_start[static_cast<size_t>(dfa.next(s, a)) * k + a + 1];
+    }
+  }
+  for (size_t i = 1; i < predecessor_start.size(); ++i) {
+    predecessor_start[i] += predecessor_start[i - 1];
+  }
+  std::vector<int> predecessors(predecessor_start.back());
+  {
+    std::vector<int> fill(predecessor_start.begin(), predecessor_start.end() - 1);
+    for (int s = 0; s < n; ++s) {
+      for (int a = 0; a < k; ++a) {
+        predecessors[fill[static_cast<size_t>(dfa.next(s, a)) * k + a]++] = s;
+      }
+    }
+  }
+
+  // elements[block_start[b], block_end[b]) are the states of block b
+  std::vector<int> elements(n);
+  std::vector<int> location(n);
+  std::vector<int> block_of(n);
+  std::vector<int> block_start{};
+  std::vector<int> block_end{};
+  std::vector<int> marked_count{};
+
+  int next_slot{0};
+  for (const bool accepting : {true, false}) {
+    const int first{next_slot};
+    for (int s = 0; s < n; ++s) {
+      if (dfa.accept[s] == accepting) {
+        elements[next_slot] = s;
+        location[s] = next_slot++;
+        block_of[s] = static_cast<int>(block_start.size());
+      }
+    }
+    if (next_slot > first) {
+      block_start.push_back(first);
+      block_end.push_back(next_slot);
+      marked_count.push_back(0);
+    }
+  }
+
+  std::vector<std::pair<int, int>> worklist{};
+  std::vector<bool> queued{};
+  auto queue = [&](int block, int symbol) {
+    const size_t slot = static_cast<size_t>(block) * k + symbol;
+    if (queued.size() <= slot) queued.resize((static_cast<size_t>(block) + 1) * k, false);
+    if (!queued[slot]) {
+      queued[slot] = true;
+      worklist.emplace_back(block, symbol);
+    }
+  };
+  auto is_queued = [&](int block, int symbol) {
+    const size_t slot = static_cast<size_t>(block) * k + symbol;
+    return slot < queued.size() && queued[slot];
+  };
+
+  // Queuing only the smaller initial block is enough
+  const int smallest{block_start.size() == 2 &&
+                             block_end[1] - block_start[1] < block_end[0] - block_start[0]
+                         ? 1
+                         : 0};
+  for (int a = 0; a < k; ++a) {
+    queue(smallest, a);
+  }
+
+  std::vector<int> splitter{};
+  std::vector<int> touched_blocks{};
+  while (!worklist.empty()) {
+    const auto [splitter_block, symbol] = worklist.back();
+    worklist.pop_back();
+    queued[static_cast<size_t>(splitter_block) * k + symbol] = false;
+
+    // Copy the splitter first, it may itself be split below
+    splitter.assign(elements.begin() + block_start[splitter_block],
+                    elements.begin() + block_end[splitter_block]);
+
+    // Move every predecessor to the front of its block
+    for (const int target : splitter) {
+      const size_t cell = static_cast<size_t>(target) * k + symbol;
+      for (int p = predecessor_start[cell]; p < predecessor_start[cell + 1]; ++p) {
+        const int s{predecessors[p]};
+        const int b{block_of[s]};
+        const int marked_end{block_start[b] + marked_count[b]};
+        if (location[s] < marked_end) continue;
+
+        if (marked_count[b] == 0) touched_blocks.push_back(b);
+        const int other{elements[marked_end]};
+        std::swap(elements[location[s]], elements[marked_end]);
+        location[other] = location[s];
+        location[s] = marked_end;
+        ++marked_count[b];
+      }
+    }
+
+    for (const int b : touched_blocks) {
+      const int marked{marked_count[b]};
+      marked_count[b] = 0;
+      if (marked == block_end[b] - block_start[b]) continue;
+
+      // Split the marked prefix off into a new block
+      const int split{static_cast<int>(block_start.size())};
+      block_start.push_back(block_start[b]);
+      block_end.push_back(block_start[b] + marked);
+      marked_count.push_back(0);
+      block_start[b] += marked;
+      for (int i = block_start[split]; i < block_end[split]; ++i) {
+        block_of[elements[i]] = split;
+      }
+
+      const bool split_is_smaller{marked <= block_end[b] - block_start[b]};
+      for (int a = 0; a < k; ++a) {
+        if (is_queued(b, a) || split_is_smaller) {
+          queue(split, a);
+        } else {
+          queue(b, a);
+        }
+      }
+    }
+    touched_blocks.clear();
+  }
+
+  // Number the blocks breadth first from the start state's block
+  const int block_count{static_cast<int>(block_start.size())};
+  std::vector<int> renumbered(block_count, -1);
+  std::vector<int> order{block_of[0]};
+  renumbered[block_of[0]] = 0;
+  for (size_t i = 0; i < order.size(); ++i) {
+    const int representative{elements[block_start[order[i]]]};
+    for (int a = 0; a < k; ++a) {
+      const int b{block_of[dfa.next(representative, a)]};
+      if (renumbered[b] == -1) {
+        renumbered[b] = static_cast<int>(order.size());
+        order.push_back(b);
+      }
+    }
+  }
+
+  DenseDFA minimal{static_cast<int>(order.size()), k, {}, {}};
+  minimal.transitions.resize(order.size() * k);
+  minimal.accept.resize(order.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    const int representative{elements[block_start[order[i]]]};
+    minimal.accept[i] = dfa.accept[representative];
+    for (int a = 0; a < k; ++a) {
+      minimal.transitions[i * k + a] =
+          renumbered[block_of[dfa.next(representative, a)]];
+    }
+  }
+  return minimal;
+}
+
+#endif
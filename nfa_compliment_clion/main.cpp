@@ -1,61 +1,51 @@
-#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
-#include <iterator>
 #include <map>
+#include <mutex>
+#include <optional>
 #include <set>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
-#define EPSILON "eps"
+#include "AntichainChecks.h"
+#include "BinaryDFA.h"
+#include "DenseDFA.h"
+#include "EpsilonClosures.h"
 
-bool append_unique(std::vector<int> &v, int val) {
-  for (const auto &i : v) {
-    if (i == val) {
-      return false;
-    }
-  }
-
-  v.push_back(val);
-  return true;
-}
+#define EPSILON "eps"
 
-bool operator<(const std::set<int> &s1, const std::set<int> &s2) {
-  if (s1.size() > s2.size())
-    return false;
-  else if (s1.size() < s2.size())
-    return true;
-
-  for (int i = 0; i < s1.size(); ++i) {
-    int s1_value = *std::next(s1.begin(), i);
-    int s2_value = *std::next(s2.begin(), i);
-    if (s1_value < s2_value) {
-      return true;
+// Hash of a sorted NFA state set, used to look up the DFA state built for it.
+struct StateSetHash {
+  size_t operator()(const std::vector<int> &state_set) const {
+    size_t h{state_set.size()};
+    for (int s : state_set) {
+      h ^= std::hash<int>{}(s) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
     }
+    return h;
   }
-
-  // The two sets are identical
-  return false;
-}
+};
 
 class DFA_State {
 private:
   int id{};
 
 public:
-  std::set<int> state_set;
-  std::map<std::string, std::set<int>> transitions{};
+  // Sorted NFA states this DFA state stands for
+  std::vector<int> state_set;
+  // Target DFA state id for each symbol, in alphabet order
+  std::vector<int> transitions{};
   bool is_accept_state{false};
   bool is_sink_state{false};
 
-  DFA_State(const std::set<int> &state_set,
+  DFA_State(const std::vector<int> &state_set,
             const std::set<std::string> &alphabet,
             const std::map<int, bool> &nfa_accept_states)
-      : state_set{state_set} {
-    for (const std::string &symbol : alphabet) {
-      transitions[symbol] = {};
-    }
-
+      : state_set{state_set}, transitions(alphabet.size(), -1) {
     for (int i : state_set) {
       if (nfa_accept_states.at(i)) {
         is_accept_state = true;
@@ -77,102 +67,11 @@ public:
     this->is_accept_state = !is_accept_state;
   }
 
-  std::vector<std::string>
-  transitions_to_string(std::vector<DFA_State> dfa_states) const {
-    std::vector<std::string> transitions_to_string{};
-    for (const auto &t : transitions) {
-      if (!is_sink_state || is_accept_state) {
-        for (const auto &state : dfa_states) {
-          if (state.state_set == t.second) {
-            std::string transition_str = std::to_string(get_id()) + " " +
-                                         t.first + " " +
-                                         std::to_string(state.get_id());
-            transitions_to_string.push_back(transition_str);
-          }
-        }
-      }
-    }
-
-    return transitions_to_string;
-  }
-
   inline void set_id(int _id) { this->id = _id; }
 
   [[nodiscard]] inline int get_id() const { return this->id; }
-
-  bool operator==(const DFA_State &ds) const {
-    if (this->state_set.size() != ds.state_set.size())
-      return false;
-
-    if (this->state_set.empty() && ds.state_set.empty())
-      return true;
-
-    for (int i = 0; i < this->state_set.size(); ++i) {
-      int s1_value = *std::next(this->state_set.begin(), i);
-      int s2_value = *std::next(ds.state_set.begin(), i);
-      if (s1_value != s2_value) {
-        return false;
-      }
-    }
-
-    return true;
-  }
-
-  bool operator<(const DFA_State &ds) const {
-    if (this->state_set.size() > ds.state_set.size())
-      return false;
-    else if (this->state_set.size() < ds.state_set.size())
-      return true;
-
-    // They will have to have the same size to have gotten here
-    for (int i = 0; i < this->state_set.size(); ++i) {
-      int s1_value = *std::next(this->state_set.begin(), i);
-      int s2_value = *std::next(ds.state_set.begin(), i);
-      if (s1_value < s2_value) {
-        return true;
-      }
-    }
-
-    // The two sets are identical
-    return false;
-  }
 };
 
-bool operator==(const std::set<int> &s1, const std::set<int> &s2) {
-  if (s1.size() != s2.size())
-    return false;
-
-  if (s1.empty() && s2.empty())
-    return true;
-
-  for (int i = 0; i < s1.size(); ++i) {
-    int s1_value = *std::next(s1.begin(), i);
-    int s2_value = *std::next(s2.begin(), i);
-    if (s1_value != s2_value) {
-      return false;
-    }
-  }
-
-  return true;
-}
-
-bool operator!=(const std::set<int> &s1, const std::set<int> &s2) {
-  if (s1.size() != s2.size())
-    return true;
-  if (s1.empty() && s2.empty())
-    return false;
-
-  for (int i = 0; i < s1.size(); ++i) {
-    int s1_value = *std::next(s1.begin(), i);
-    int s2_value = *std::next(s2.begin(), i);
-    if (s1_value != s2_value) {
-      return true;
-    }
-  }
-
-  return false;
-}
-
 std::ostream &operator<<(std::ostream &stream, std::vector<std::string> vec) {
   for (const std::string &s : vec) {
     stream << s << '\n';
@@ -234,46 +133,23 @@ public:
   }
 };
 
-std::map<int, std::set<int>> populate_epsilon_transitions_map(
-    const std::vector<NFA::Transition> &transitions,
-    const int number_of_states) {
-  std::map<int, std::set<int>> epsilon_expansions_map{};
-  bool foundEpsilon{false};
-  for (int i = 0; i < number_of_states; ++i) {
-    epsilon_expansions_map[i] = {};
-  }
+// Epsilon closure of every state, indexed by state. Transitions out of range
+// are ignored.
+std::pair<std::vector<int>, std::vector<int>>
+epsilon_closures(int number_of_states,
+                 const std::vector<NFA::Transition> &transitions) {
+  std::vector<std::vector<int>> epsilon_edges(number_of_states);
   for (const NFA::Transition &t : transitions) {
-    if (t.symbol == EPSILON) {
-      foundEpsilon = true;
-      break;
+    if (t.symbol == EPSILON && t.from >= 0 && t.from < number_of_states &&
+        t.to >= 0 && t.to < number_of_states) {
+      epsilon_edges[t.from].push_back(t.to);
     }
   }
-  if (!foundEpsilon)
-    return epsilon_expansions_map;
 
-  for (const NFA::Transition &t : transitions) {
-    if (t.symbol == EPSILON) {
-      epsilon_expansions_map.at(t.from).insert(t.to);
-    }
-  }
-  return epsilon_expansions_map;
-}
-
-std::vector<int> get_epsilon_expansion_states(
-    const NFA::Transition &transition,
-    const std::map<int, std::set<int>> &epsilon_expansions_map) {
-  std::vector<int> states_to_expand{transition.from, transition.to};
-  int i{0};
-  while (i < states_to_expand.size()) {
-    int current_state_to_expand = states_to_expand[i];
-    std::set<int> states = epsilon_expansions_map.at(current_state_to_expand);
-    for (int s : states) {
-      append_unique(states_to_expand, s);
-    }
-    i++;
-  }
-
-  return states_to_expand;
+  std::pair<std::vector<int>, std::vector<int>> closures{};
+  compute_epsilon_closures(number_of_states, epsilon_edges, closures.first,
+                           closures.second);
+  return closures;
 }
 
 std::pair<std::map<int, std::vector<TransitionPair>>,
@@ -282,57 +158,39 @@ construct_transitions_table_for_alphabet(
     int number_of_states, const std::set<std::string> &alphabet,
     const std::vector<NFA::Transition> &transitions) {
   std::map<int, std::vector<TransitionPair>> transitions_table{};
-  std::map<int, std::set<int>> epsilon_expansion_transitions_map{
-      populate_epsilon_transitions_map(transitions, number_of_states)};
 
   // Map state => the set of states the machine would expand to be in upon
   // reaching this state.
   std::map<int, std::set<int>> epsilon_expansions{};
-  for (int i = 0; i < number_of_states; ++i) {
-    epsilon_expansions[i] = {};
-  }
-
-  // Initialize table cells for all states and symbols
-  for (int i = 0; i < number_of_states; ++i) {
-    for (const auto &symbol : alphabet) {
-      TransitionPair p{symbol};
-      transitions_table[i].push_back(p);
-    }
+  const auto [closure_offsets, closure_targets] =
+      epsilon_closures(number_of_states, transitions);
+
+  // Symbol transitions grouped by source state, with the symbol as its
+  // position in the alphabet
+  std::map<std::string, int> symbol_index{};
+  for (const std::string &symbol : alphabet) {
+    symbol_index.emplace(symbol, static_cast<int>(symbol_index.size()));
   }
-
-  // Populate the epsilon expansions first
-  for (const NFA::Transition &transition : transitions) {
-    if (transition.symbol != EPSILON) {
-      continue;
-    }
-    std::set<int> &item = epsilon_expansions.at(transition.from);
-    std::vector<int> states_to_expand{get_epsilon_expansion_states(
-        transition, epsilon_expansion_transitions_map)};
-
-    for (int state : states_to_expand) {
-      item.insert(state);
+  std::vector<std::vector<std::pair<int, int>>> moves(number_of_states);
+  for (const NFA::Transition &t : transitions) {
+    if (t.symbol != EPSILON && t.from >= 0 && t.from < number_of_states) {
+      moves[t.from].emplace_back(symbol_index.at(t.symbol), t.to);
     }
   }
 
+  // A state moves on a symbol wherever a state in its closure does
   for (int i = 0; i < number_of_states; ++i) {
-    std::set<int> epsilon_expanded_states{i};
-    std::set<int> expansions = epsilon_expansions.at(i);
-    // Populate epsilon expanded states set
-    for (const auto cell : expansions) {
-      epsilon_expanded_states.insert(cell);
+    std::vector<TransitionPair> &row = transitions_table[i];
+    for (const auto &symbol : alphabet) {
+      row.emplace_back(symbol);
     }
 
-    for (const std::string &symbol : alphabet) {
-      for (auto state : epsilon_expanded_states) {
-        for (const NFA::Transition &t : transitions) {
-          if (state == t.from && t.symbol == symbol) {
-            for (TransitionPair &p : transitions_table.at(i)) {
-              if (p.symbol == symbol) {
-                p.to.insert(t.to);
-              }
-            }
-          }
-        }
+    std::set<int> &expansion = epsilon_expansions[i];
+    for (int c = closure_offsets[i]; c < closure_offsets[i + 1]; ++c) {
+      const int state{closure_targets[c]};
+      expansion.insert(expansion.end(), state);
+      for (const auto &[symbol, to] : moves[state]) {
+        row[symbol].to.insert(to);
       }
     }
   }
@@ -386,99 +244,339 @@ NFA read_nfa_definition_input() {
           accept_states};
 }
 
-int main() {
-  NFA n{read_nfa_definition_input()};
+// Union of the moves of every NFA state in state_set, one sorted target set
+// per symbol (in alphabet order). `collected` holds generation stamps, one
+// slot per (symbol, NFA state), so duplicates are skipped without a set.
+void collect_targets(const NFA &n, const std::vector<int> &state_set,
+                     std::vector<std::vector<int>> &targets,
+                     std::vector<size_t> &collected, size_t &generation) {
+  ++generation;
+  for (std::vector<int> &target : targets) {
+    target.clear();
+  }
 
-  int max_dfa_state_count{static_cast<int>(pow(2, n.states))};
+  for (int nfa_state : state_set) {
+    size_t symbol{0};
+    for (const TransitionPair &t : n.transition_table.at(nfa_state)) {
+      std::vector<int> &target = targets[symbol];
+      size_t *seen = collected.data() + symbol * n.states;
+      for (int state : t.to) {
+        if (seen[state] != generation) {
+          seen[state] = generation;
+          target.push_back(state);
+        }
+
+        for (const auto &s : n.epsilon_expansions.at(state)) {
+          if (seen[s] != generation) {
+            seen[s] = generation;
+            target.push_back(s);
+          }
+        }
+      }
+      ++symbol;
+    }
+  }
 
-  // Get the nfa epsilon expanded start states
-  std::set<int> start_states{0};
+  for (std::vector<int> &target : targets) {
+    std::sort(target.begin(), target.end());
+  }
+}
+
+// 2^n bounds the number of subsets; past 63 states it no longer fits, and
+// the table will run out of memory long before reaching it anyway
+size_t max_dfa_state_count(const NFA &n) {
+  return n.states >= 63 ? SIZE_MAX : size_t{1} << n.states;
+}
+
+// Get the nfa epsilon expanded start states
+std::vector<int> start_state_set(const NFA &n) {
+  std::set<int> start_closure{0};
   for (const auto &s : n.epsilon_expansions.at(0)) {
-    start_states.insert(s);
+    start_closure.insert(s);
   }
+  return {start_closure.begin(), start_closure.end()};
+}
 
-  // start state
-  DFA_State dfa_start_state{start_states, n.alphabet, n.acceptStates};
-  std::vector<DFA_State> dfa_states{dfa_start_state};
+// Subset construction on a single thread. DFA state i is dfa_states[i] and
+// state 0 is the start state.
+std::vector<DFA_State> determinize(const NFA &n) {
+  const std::vector<int> start_states{start_state_set(n)};
+  std::vector<DFA_State> dfa_states{
+      DFA_State{start_states, n.alphabet, n.acceptStates}};
 
-  int i{0};
-  do {
-    DFA_State &dfa_state = dfa_states[i];
+  // Set of NFA states => id of the DFA state (index in dfa_states) for it
+  std::unordered_map<std::vector<int>, int, StateSetHash> dfa_state_ids{};
+  dfa_state_ids.emplace(start_states, 0);
 
-    std::vector<DFA_State> new_dfa_states{};
+  const size_t symbol_count{n.alphabet.size()};
+  std::vector<size_t> collected(symbol_count * n.states, 0);
+  size_t generation{0};
+  std::vector<std::vector<int>> targets(symbol_count);
 
-    // Using the current dfa state's state_set, get the set of states each one
-    // of those states will take you to for each symbol. Keep the union of all
-    // of them for each symbol
-    for (int nfa_state : dfa_state.state_set) {
-      for (const TransitionPair &t : n.transition_table.at(nfa_state)) {
-        if (t.symbol == EPSILON)
-          continue;
-        std::set<int> &set = dfa_state.transitions.at(t.symbol);
-        for (int state : t.to) {
-          set.insert(state);
+  for (size_t i = 0; i < dfa_states.size(); ++i) {
+    collect_targets(n, dfa_states[i].state_set, targets, collected, generation);
 
-          for (const auto &s : n.epsilon_expansions.at(state)) {
-            set.insert(s);
-          }
-        }
+    // For each "to" transition in the dfa state, add a new DFA state if it
+    // isn't already in the table
+    for (size_t symbol = 0; symbol < symbol_count; ++symbol) {
+      const auto [entry, added] =
+          dfa_state_ids.emplace(targets[symbol], dfa_states.size());
+      if (added) {
+        dfa_states.emplace_back(entry->first, n.alphabet, n.acceptStates);
       }
+      dfa_states[i].transitions[symbol] = entry->second;
     }
 
-    // For each "to" transition in the dfa state, add a new DFA state if it
-    // wasn't already in the table
-    for (const std::string &symbol : n.alphabet) {
-      std::set<int> set_states{dfa_state.transitions.at(symbol)};
-      DFA_State new_state{set_states, n.alphabet, n.acceptStates};
-      bool should_add{true};
-      // Confirm that the state isn't already in the dfa table
-      for (const DFA_State &ds : dfa_states) {
-        if (new_state == ds) {
-          should_add = false;
-          break;
-        }
-      }
-      if (should_add) {
-        // Confirm that the state isn't added multiple times from symbols in the
-        // current table row
-        for (const DFA_State &ds : new_dfa_states) {
-          if (new_state == ds) {
-            should_add = false;
-            break;
+    if (dfa_states.size() > max_dfa_state_count(n)) {
+      break;
+    }
+  }
+
+  return dfa_states;
+}
+
+// Set of NFA states => DFA state id, split into independently locked
+// shards so threads inserting different sets rarely wait on each other.
+class ShardedStateTable {
+public:
+  static constexpr size_t SHARD_COUNT{64};
+
+  // Returns the id for state_set and whether this call created it. New ids
+  // come from next_id, so every created state gets a distinct id.
+  std::pair<int, bool> find_or_insert(const std::vector<int> &state_set,
+                                      std::atomic<int> &next_id) {
+    const size_t hash{StateSetHash{}(state_set)};
+    Shard &shard = shards[hash % SHARD_COUNT];
+    std::lock_guard<std::mutex> lock{shard.mutex};
+    const auto found = shard.ids.find(state_set);
+    if (found != shard.ids.end()) {
+      return {found->second, false};
+    }
+    const int id{next_id++};
+    shard.ids.emplace(state_set, id);
+    return {id, true};
+  }
+
+private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::vector<int>, int, StateSetHash> ids{};
+  };
+  Shard shards[SHARD_COUNT];
+};
+
+// Subset construction one breadth first level at a time. The states found in
+// the previous level are split between the threads, which expand them and
+// insert their target sets into a shared ShardedStateTable. States created
+// during a level are placed at their ids once every thread is done.
+//
+// Ids depend on thread timing, but minimize() renumbers the result, so the
+// final output is the same as with determinize().
+std::vector<DFA_State> determinize_parallel(const NFA &n, unsigned threads) {
+  // Frontiers smaller than this are not worth handing to extra threads
+  constexpr size_t MIN_STATES_PER_THREAD{64};
+
+  const std::vector<int> start_states{start_state_set(n)};
+  std::vector<DFA_State> dfa_states{
+      DFA_State{start_states, n.alphabet, n.acceptStates}};
+
+  ShardedStateTable table{};
+  std::atomic<int> next_id{0};
+  table.find_or_insert(start_states, next_id);
+
+  const size_t symbol_count{n.alphabet.size()};
+  size_t frontier_begin{0};
+  while (frontier_begin < dfa_states.size() &&
+         dfa_states.size() <= max_dfa_state_count(n)) {
+    const size_t frontier_end{dfa_states.size()};
+    const size_t workers{std::max<size_t>(
+        1, std::min<size_t>(threads, (frontier_end - frontier_begin) /
+                                         MIN_STATES_PER_THREAD))};
+
+    std::atomic<size_t> next_state{frontier_begin};
+    std::vector<std::vector<DFA_State>> created(workers);
+    auto expand = [&](size_t worker) {
+      std::vector<size_t> collected(symbol_count * n.states, 0);
+      size_t generation{0};
+      std::vector<std::vector<int>> targets(symbol_count);
+      for (size_t i = next_state++; i < frontier_end; i = next_state++) {
+        collect_targets(n, dfa_states[i].state_set, targets, collected,
+                        generation);
+        for (size_t symbol = 0; symbol < symbol_count; ++symbol) {
+          const auto [id, added] =
+              table.find_or_insert(targets[symbol], next_id);
+          if (added) {
+            created[worker].emplace_back(targets[symbol], n.alphabet,
+                                         n.acceptStates);
+            created[worker].back().set_id(id);
           }
+          dfa_states[i].transitions[symbol] = id;
         }
       }
-      if (should_add) {
-        new_dfa_states.push_back(new_state);
+    };
+
+    std::vector<std::thread> pool{};
+    for (size_t w = 1; w < workers; ++w) {
+      pool.emplace_back(expand, w);
+    }
+    expand(0);
+    for (std::thread &t : pool) {
+      t.join();
+    }
+
+    dfa_states.resize(next_id, DFA_State{{}, n.alphabet, n.acceptStates});
+    for (std::vector<DFA_State> &states : created) {
+      for (DFA_State &state : states) {
+        const int id{state.get_id()};
+        dfa_states[id] = std::move(state);
       }
     }
+    frontier_begin = frontier_end;
+  }
+
+  return dfa_states;
+}
 
-    for (const DFA_State &ns : new_dfa_states) {
-      dfa_states.push_back(ns);
+// BitNFA form of n over the given symbol list, which may contain symbols n
+// has no transitions on.
+BitNFA to_bit_nfa(const NFA &n, const std::vector<std::string> &symbols) {
+  BitNFA bits{n.states, static_cast<int>(symbols.size())};
+  BitNFA::set_bit(bits.start.data(), 0);
+  for (int s : n.epsilon_expansions.at(0)) {
+    BitNFA::set_bit(bits.start.data(), s);
+  }
+  for (int state = 0; state < n.states; ++state) {
+    if (n.acceptStates.at(state)) {
+      BitNFA::set_bit(bits.accept.data(), state);
     }
-    i++;
-    if (i == dfa_states.size() || dfa_states.size() > max_dfa_state_count) {
-      break;
+    for (const TransitionPair &t : n.transition_table.at(state)) {
+      const auto symbol = std::find(symbols.begin(), symbols.end(), t.symbol);
+      const int id{static_cast<int>(symbol - symbols.begin())};
+      for (int to : t.to) {
+        bits.add_successor(state, id, to);
+        for (int s : n.epsilon_expansions.at(to)) {
+          bits.add_successor(state, id, s);
+        }
+      }
     }
-  } while (true);
+  }
+  bits.finish();
+  return bits;
+}
+
+// Answer a language question about the NFA(s) on stdin without building a
+// DFA. Prints "yes", or "no" followed by a word that shows why (symbols
+// separated by spaces, "eps" for the empty word).
+int run_language_check(const std::string &check) {
+  NFA first{read_nfa_definition_input()};
+  std::set<std::string> alphabet{first.alphabet};
+  std::optional<NFA> second{};
+  if (check != "--universal") {
+    second.emplace(read_nfa_definition_input());
+    alphabet.insert(second->alphabet.begin(), second->alphabet.end());
+  }
+  const std::vector<std::string> symbols(alphabet.begin(), alphabet.end());
+
+  CheckResult result{};
+  if (check == "--universal") {
+    result = check_universality(to_bit_nfa(first, symbols));
+  } else if (check == "--included") {
+    result = check_inclusion(to_bit_nfa(first, symbols), to_bit_nfa(*second, symbols));
+  } else {
+    result = check_equivalence(to_bit_nfa(first, symbols), to_bit_nfa(*second, symbols));
+  }
+
+  if (result.holds) {
+    std::cout << "yes" << '\n';
+    return 0;
+  }
+  std::cout << "no" << '\n';
+  if (result.counterexample.empty()) {
+    std::cout << EPSILON;
+  }
+  for (size_t i = 0; i < result.counterexample.size(); ++i) {
+    std::cout << (i ? " " : "") << symbols[result.counterexample[i]];
+  }
+  std::cout << '\n';
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  unsigned threads{std::max(1u, std::thread::hardware_concurrency())};
+  std::string binary_path{};
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    if (arg == "--threads" && i + 1 < argc) {
+      threads = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--binary" && i + 1 < argc) {
+      binary_path = argv[++i];
+    } else if (arg == "--universal" || arg == "--included" ||
+               arg == "--equivalent") {
+      // Checks on one NFA (--universal) or two NFAs given one after the
+      // other: is the first included in / equivalent to the second
+      return run_language_check(arg);
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--threads N] [--binary dfa_file] < nfa" << '\n'
+                << "       " << argv[0]
+                << " --universal < nfa | --included < nfa nfa"
+                << " | --equivalent < nfa nfa" << std::endl;
+      return 1;
+    }
+  }
+
+  NFA n{read_nfa_definition_input()};
+  const size_t symbol_count{n.alphabet.size()};
+
+  std::vector<DFA_State> dfa_states{threads > 1 ? determinize_parallel(n, threads)
+                                                : determinize(n)};
 
   // Convert to compliment
   for (int d = 0; d < dfa_states.size(); ++d) {
     dfa_states[d].convert_state_to_compliment(d);
   }
 
+  DenseDFA compliment{static_cast<int>(dfa_states.size()),
+                      static_cast<int>(symbol_count),
+                      {},
+                      {}};
+  for (const DFA_State &dfa_state : dfa_states) {
+    compliment.transitions.insert(compliment.transitions.end(),
+                                  dfa_state.transitions.begin(),
+                                  dfa_state.transitions.end());
+    compliment.accept.push_back(dfa_state.is_accept_state);
+  }
+  const DenseDFA minimal{minimize(compliment)};
+
+  const std::vector<std::string> symbol_names(n.alphabet.begin(),
+                                              n.alphabet.end());
+  if (!binary_path.empty()) {
+    const std::string error{write_binary_dfa(binary_path, minimal.states,
+                                             symbol_names, minimal.transitions,
+                                             minimal.accept)};
+    if (!error.empty()) {
+      std::cerr << error << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  // Transition targets are state ids already, so writing them out is a
+  // single pass over the table
   std::vector<int> accept_states{};
   std::vector<std::string> transitions_to_string{};
-  for (const auto &dfa_state : dfa_states) {
-    if (dfa_state.is_accept_state) {
-      accept_states.push_back(dfa_state.get_id());
+  for (int state = 0; state < minimal.states; ++state) {
+    if (minimal.accept[state]) {
+      accept_states.push_back(state);
     }
-    for (auto str_transition : dfa_state.transitions_to_string(dfa_states)) {
-      transitions_to_string.push_back(str_transition);
+    for (int symbol = 0; symbol < minimal.symbols; ++symbol) {
+      transitions_to_string.push_back(std::to_string(state) + " " +
+                                      symbol_names[symbol] + " " +
+                                      std::to_string(minimal.next(state, symbol)));
     }
   }
 
-  std::cout << dfa_states.size() << '\n';
+  std::cout << minimal.states << '\n';
   std::cout << transitions_to_string.size() << '\n';
   std::cout << transitions_to_string;
 
@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <iostream>
-#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <set>
+
+#include "../nfa_common/BatchRunner.h"
 
 #define EPSILON "eps"
 
@@ -33,29 +35,61 @@ public:
   }
 };
 
-class State
+// The states of the NFA packed into flat arrays and addressed by index. The
+// symbol transitions of state i are [transitionStart[i], transitionStart[i + 1])
+// of transitionSymbols / transitionTargets, and its epsilon transitions are
+// [epsilonStart[i], epsilonStart[i + 1]) of epsilonTargets.
+class StateArena
 {
 public:
-  struct TransitionFunction
-  {
-    std::string symbol{};
-    std::shared_ptr<State> to_state;
-  };
+  std::vector<char> accept{};
+  std::vector<int> transitionStart{};
+  std::vector<char> transitionSymbols{};
+  std::vector<int> transitionTargets{};
+  std::vector<int> epsilonStart{};
+  std::vector<int> epsilonTargets{};
+
+  int size() const { return static_cast<int>(accept.size()); }
+};
+
+// A set of states used during one simulation step. Membership is tracked with
+// a generation stamp per state, so clearing the set only bumps the generation.
+class StateSet
+{
+public:
+  std::vector<int> members{};
+
+  explicit StateSet(int states) : stamps(states, 0) {}
 
-  bool accept{};
-  int state;
-  std::vector<TransitionFunction> transition_functions{};
-  std::set<int> epsilonTransitions{};
+  bool insert(int state)
+  {
+    if (stamps[state] == generation)
+      return false;
+    stamps[state] = generation;
+    members.push_back(state);
+    return true;
+  }
 
-  State(int s, bool a) : state{s}, accept{a} {}
+  void clear()
+  {
+    members.clear();
+    ++generation;
+  }
 
-  friend bool operator<(const std::shared_ptr<State> &left, const std::shared_ptr<State> &right);
+private:
+  std::vector<size_t> stamps;
+  size_t generation{1};
 };
 
-bool operator<(const std::shared_ptr<State> &left, const std::shared_ptr<State> &right)
+// Per thread buffers reused across test strings
+struct SimulationScratch
 {
-  return left->state < right->state;
-}
+  StateSet validStates;
+  StateSet nextValidStates;
+  std::vector<int> expansionStack{};
+
+  explicit SimulationScratch(int states) : validStates{states}, nextValidStates{states} {}
+};
 
 NFA::Transition split_transition_input(std::string transitionString)
 {
@@ -128,71 +162,139 @@ std::vector<std::string> read_test_strings()
   return test_strings;
 }
 
-std::vector<std::shared_ptr<State>> buildStateObjects(NFA &n)
+// Lay out the transitions grouped by their from state (a counting sort).
+// Symbols other than a single character can never match an input character,
+// so they are dropped here.
+StateArena buildStateArena(const NFA &n)
 {
-  std::vector<std::shared_ptr<State>> states{};
+  StateArena arena{};
+  arena.accept.assign(n.states, false);
+  for (int s : n.acceptStates)
+  {
+    if (s >= 0 && s < n.states)
+      arena.accept[s] = true;
+  }
+
+  arena.transitionStart.assign(n.states + 1, 0);
+  arena.epsilonStart.assign(n.states + 1, 0);
+  for (const NFA::Transition &t : n.transitions)
+  {
+    if (t.symbol == EPSILON)
+      ++arena.epsilonStart[t.from + 1];
+    else if (t.symbol.size() == 1)
+      ++arena.transitionStart[t.from + 1];
+  }
   for (int i = 0; i < n.states; ++i)
   {
-    std::shared_ptr<State> state = std::make_shared<State>(i, n.isAcceptState(i));
-    states.push_back(state);
+    arena.transitionStart[i + 1] += arena.transitionStart[i];
+    arena.epsilonStart[i + 1] += arena.epsilonStart[i];
   }
 
-  for (auto t : n.transitions)
+  arena.transitionSymbols.resize(arena.transitionStart[n.states]);
+  arena.transitionTargets.resize(arena.transitionStart[n.states]);
+  arena.epsilonTargets.resize(arena.epsilonStart[n.states]);
+  std::vector<int> transitionFill(arena.transitionStart.begin(), arena.transitionStart.end() - 1);
+  std::vector<int> epsilonFill(arena.epsilonStart.begin(), arena.epsilonStart.end() - 1);
+  for (const NFA::Transition &t : n.transitions)
   {
-    states[t.from]->transition_functions.push_back(State::TransitionFunction{t.symbol, states[t.to]});
     if (t.symbol == EPSILON)
     {
-      states[t.from]->epsilonTransitions.insert(t.to);
+      arena.epsilonTargets[epsilonFill[t.from]++] = t.to;
+    }
+    else if (t.symbol.size() == 1)
+    {
+      const int slot = transitionFill[t.from]++;
+      arena.transitionSymbols[slot] = t.symbol[0];
+      arena.transitionTargets[slot] = t.to;
     }
   }
-  return states;
+  return arena;
 }
 
-std::string asString(char x)
+// Add state and everything reachable from it through epsilon transitions to
+// validNextStates. States already in the set are not expanded again.
+void performStateEpsilonExpansion(
+    int state,
+    StateSet &validNextStates,
+    const StateArena &arena,
+    std::vector<int> &stack)
 {
-  std::string s{x};
-  return s;
+  if (!validNextStates.insert(state))
+    return;
+
+  stack.push_back(state);
+  while (!stack.empty())
+  {
+    const int current = stack.back();
+    stack.pop_back();
+    for (int e = arena.epsilonStart[current]; e < arena.epsilonStart[current + 1]; ++e)
+    {
+      if (validNextStates.insert(arena.epsilonTargets[e]))
+        stack.push_back(arena.epsilonTargets[e]);
+    }
+  }
 }
 
-std::set<std::shared_ptr<State>> performStateEpsilonExpansion(
-    const std::shared_ptr<State> &state,
-    std::set<std::shared_ptr<State>> validNextStates,
-    const std::vector<std::shared_ptr<State>> &states)
+bool containsAcceptState(const StateSet &validStates, const StateArena &arena)
 {
-  std::vector<std::shared_ptr<State>> result{state};
-  validNextStates.insert(state);
-  bool shouldContinue{false};
-  int i{0};
-  do
+  for (int state : validStates.members)
   {
-    shouldContinue = false;
-    for (auto t : result[i]->epsilonTransitions)
+    if (arena.accept[state])
     {
-      auto out = validNextStates.insert(states[t]);
-      if (out.second)
-      {
-        result.push_back(states[t]);
-        shouldContinue = true;
-      }
+      return true;
     }
-    ++i;
-    if (i > states.size())
-      break;
-  } while (shouldContinue);
-  return validNextStates;
+  }
+  return false;
 }
 
-void produceOutput(const std::set<std::shared_ptr<State>> &validStates)
+bool simulate(std::string_view testString, const StateArena &arena, SimulationScratch &scratch)
 {
-  for (std::shared_ptr<State> state : validStates)
+  StateSet &validStates = scratch.validStates;
+  StateSet &nextValidStates = scratch.nextValidStates;
+  validStates.clear();
+  performStateEpsilonExpansion(0, validStates, arena, scratch.expansionStack);
+
+  for (const char c : testString)
   {
-    if (state->accept == true)
+    nextValidStates.clear();
+    for (int state : validStates.members)
     {
-      std::cout << "accept" << std::endl;
-      return;
+      for (int t = arena.transitionStart[state]; t < arena.transitionStart[state + 1]; ++t)
+      {
+        if (arena.transitionSymbols[t] == c)
+        {
+          performStateEpsilonExpansion(arena.transitionTargets[t], nextValidStates, arena, scratch.expansionStack);
+        }
+      }
     }
+
+    std::swap(validStates, nextValidStates);
+    if (validStates.members.empty())
+      return false;
   }
-  std::cout << "reject" << std::endl;
+
+  return containsAcceptState(validStates, arena);
+}
+
+// Matcher for BatchRunner: the arena is only read during simulation so all
+// workers share it, and each worker keeps its own scratch buffers.
+struct ArenaMatcher
+{
+  const StateArena *arena;
+  SimulationScratch scratch;
+
+  bool accepts(std::string_view testString) { return simulate(testString, *arena, scratch); }
+};
+
+// Simulate every test string on the shared batch runner, which writes the
+// verdicts in order as each chunk of strings finishes.
+void simulateBatch(const std::vector<std::string> &testStrings, const StateArena &arena)
+{
+  BatchRunner<ArenaMatcher> runner{[&arena]()
+                                   { return ArenaMatcher{&arena, SimulationScratch{arena.size()}}; }};
+  const std::vector<std::string_view> inputs(testStrings.begin(), testStrings.end());
+  runner.run(inputs, std::cout);
+  std::cout << std::flush;
 }
 
 NFA test_run()
@@ -216,52 +318,15 @@ std::vector<std::string> test_run_strings() { return {"", "a", "aa"}; }
 
 int main()
 {
+  std::ios::sync_with_stdio(false);
+
   NFA n{read_nfa_definition_input()};
   std::vector<std::string> testStrings{read_test_strings()};
   // NFA n{test_run()};
   // std::vector<std::string> testStrings = test_run_strings();
 
-  std::vector<std::shared_ptr<State>> states = buildStateObjects(n);
-
-  for (std::string testString : testStrings)
-  {
-    std::set<std::shared_ptr<State>> validStates{states[0]};
-    std::set<std::shared_ptr<State>> nextValidStates{};
-
-    if (testString == "")
-    {
-      validStates = performStateEpsilonExpansion(states[0], nextValidStates, states);
-    }
-    else
-    {
-      for (int j = 0; j < testString.length(); ++j)
-      {
-        if (j == 0)
-        {
-          validStates = performStateEpsilonExpansion(states[0], nextValidStates, states);
-        }
-        for (std::shared_ptr<State> state : validStates)
-        {
-          for (State::TransitionFunction transition : state->transition_functions)
-          {
-            if (transition.symbol == asString(testString[j]))
-            {
-              nextValidStates = performStateEpsilonExpansion(transition.to_state, nextValidStates, states);
-            }
-          }
-        }
-
-        validStates.clear();
-        if (nextValidStates.size() > 0)
-        {
-          validStates = nextValidStates;
-          nextValidStates.clear();
-        }
-      }
-    }
-
-    produceOutput(validStates);
-  }
+  const StateArena arena = buildStateArena(n);
+  simulateBatch(testStrings, arena);
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+#ifndef AUTOMATON_SEARCH_H
+#define AUTOMATON_SEARCH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BitParallelNFA.h"
+#include "CompiledNFA.h"
+
+#define NO_MATCH_START std::string::npos
+
+// Finds every place in a line where a match of the automaton ends, instead
+// of only asking whether the whole line is accepted. The forward pass acts
+// as if the start state had a self loop on every byte: the start set is
+// OR-ed back into the active set after each step, so a match may begin at
+// any offset. Whenever the active set contains an accept state a match ends
+// there.
+//
+// If the CompiledNFA is supplied as well, match starts are tracked in the
+// same forward pass instead: every active state carries the leftmost offset
+// a run now in that state began at. What can still follow a state does not
+// depend on where the run began, so keeping only the leftmost start per state
+// loses nothing, and the smallest start over the active accept states is the
+// leftmost start of a match ending here. This walks successor lists state by
+// state rather than a word at a time, but stays linear in the line length.
+class AutomatonSearch {
+public:
+    explicit AutomatonSearch(const BitParallelNFA &forward, const CompiledNFA *compiled = nullptr)
+            : forward{forward}, compiled{compiled},
+              current(forward.word_count()), next(forward.word_count()),
+              leftmost(compiled ? compiled->state_count() : 0, NO_MATCH_START),
+              next_leftmost(compiled ? compiled->state_count() : 0, NO_MATCH_START) {}
+
+    // Call report(start, end) for every end offset in `line` at which a match
+    // ends. start is NO_MATCH_START when there is no CompiledNFA.
+    template<typename Report>
+    void scan(std::string_view line, Report report) {
+        if (forward.word_count() == 0) return;
+        if (compiled) {
+            scan_with_starts(line, report);
+            return;
+        }
+        if (forward.is_small()) {
+            scan_small(line, report);
+            return;
+        }
+
+        const std::vector<uint64_t> &start = forward.start_set();
+        current = start;
+        if (forward.intersects_accept(current.data())) report(NO_MATCH_START, size_t{0});
+        for (size_t i = 0; i < line.size(); ++i) {
+            const int symbol = forward.symbol_id(static_cast<unsigned char>(line[i]));
+            if (symbol == NO_SYMBOL) {
+                std::fill(next.begin(), next.end(), 0);
+            } else {
+                forward.step(current.data(), next.data(), symbol);
+            }
+            for (size_t w = 0; w < next.size(); ++w) {
+                next[w] |= start[w];
+            }
+            std::swap(current, next);
+            if (forward.intersects_accept(current.data())) report(NO_MATCH_START, i + 1);
+        }
+    }
+
+private:
+    const BitParallelNFA &forward;
+    const CompiledNFA *compiled;
+    std::vector<uint64_t> current;
+    std::vector<uint64_t> next;
+    // Leftmost start of the runs in each state, NO_MATCH_START when the
+    // state is not active; the active states are listed in active
+    std::vector<size_t> leftmost;
+    std::vector<size_t> next_leftmost;
+    std::vector<int> active{};
+    std::vector<int> next_active{};
+
+    template<typename Report>
+    void scan_small(std::string_view line, Report report) {
+        const uint64_t start{forward.start_set()[0]};
+        const uint64_t accept{forward.accept_set()[0]};
+        uint64_t set{start};
+        if (set & accept) report(NO_MATCH_START, size_t{0});
+        for (size_t i = 0; i < line.size(); ++i) {
+            const int symbol = forward.symbol_id(static_cast<unsigned char>(line[i]));
+            set = (symbol == NO_SYMBOL ? 0 : forward.step_small(set, symbol)) | start;
+            if (set & accept) report(NO_MATCH_START, i + 1);
+        }
+    }
+
+    template<typename Report>
+    void scan_with_starts(std::string_view line, Report report) {
+        for (const int s: active) {
+            leftmost[s] = NO_MATCH_START;
+        }
+        active.clear();
+        enter_start_states(0);
+        report_leftmost(0, report);
+        for (size_t i = 0; i < line.size(); ++i) {
+            const int symbol = compiled->symbol_id(static_cast<unsigned char>(line[i]));
+            next_active.clear();
+            for (const int s: active) {
+                if (symbol != NO_SYMBOL) {
+                    for (const int t: compiled->successors(s, symbol)) {
+                        if (next_leftmost[t] == NO_MATCH_START) next_active.push_back(t);
+                        next_leftmost[t] = std::min(next_leftmost[t], leftmost[s]);
+                    }
+                }
+                leftmost[s] = NO_MATCH_START;
+            }
+            std::swap(leftmost, next_leftmost);
+            std::swap(active, next_active);
+            enter_start_states(i + 1);
+            report_leftmost(i + 1, report);
+        }
+    }
+
+    // A run can begin at any offset, but one that began earlier in the same
+    // state is always preferred.
+    void enter_start_states(size_t offset) {
+        for (const int s: compiled->start_states()) {
+            if (leftmost[s] == NO_MATCH_START) {
+                leftmost[s] = offset;
+                active.push_back(s);
+            }
+        }
+    }
+
+    template<typename Report>
+    void report_leftmost(size_t end, Report &report) {
+        size_t start{NO_MATCH_START};
+        for (const int s: active) {
+            if (compiled->is_accept_state(s)) start = std::min(start, leftmost[s]);
+        }
+        if (start != NO_MATCH_START) report(start, end);
+    }
+};
+
+#endif
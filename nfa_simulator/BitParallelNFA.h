@@ -0,0 +1,193 @@
+#ifndef BIT_PARALLEL_NFA_H
+#define BIT_PARALLEL_NFA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "CompiledNFA.h"
+
+// Bit vector form of a CompiledNFA. A set of active states is one bit per
+// state packed into 64 bit words, and a step ORs together the epsilon closed
+// successor sets of the active states. Each (state, symbol) successor set is
+// kept the cheaper way to apply it: as a full width mask when it has more
+// states than a mask has words, otherwise as a list of states whose bits are
+// set one by one. A mask is only stored where it is smaller than twice its
+// list, so memory stays proportional to the successor lists rather than to
+// symbols * states^2.
+//
+// Machines with at most 64 states additionally get byte indexed tables:
+// for each symbol and each 8 bit slice of the state word the OR of all
+// masks selected by that byte is precomputed, which makes a step exactly
+// eight lookups and eight ORs.
+class BitParallelNFA {
+public:
+    static constexpr int SMALL_STATE_LIMIT{64};
+
+    explicit BitParallelNFA(const CompiledNFA &nfa)
+            : states{nfa.state_count()},
+              symbols{nfa.symbol_count()},
+              words{static_cast<size_t>((nfa.state_count() + 63) / 64)},
+              start(words, 0),
+              accept(words, 0),
+              accept_sink(words, 0) {
+        for (const int s: nfa.start_states()) {
+            set_bit(start.data(), s);
+        }
+        for (int s = 0; s < states; ++s) {
+            if (nfa.is_accept_state(s)) set_bit(accept.data(), s);
+            if (nfa.is_accept_sink(s)) set_bit(accept_sink.data(), s);
+        }
+        const size_t cells = static_cast<size_t>(states) * symbols;
+        cell_offsets.reserve(cells + 1);
+        cell_masks.reserve(cells);
+        cell_offsets.push_back(0);
+        for (int s = 0; s < states; ++s) {
+            for (int symbol = 0; symbol < symbols; ++symbol) {
+                const CompiledNFA::StateRange successors{nfa.successors(s, symbol)};
+                if (static_cast<size_t>(successors.end() - successors.begin()) > words) {
+                    cell_masks.push_back(static_cast<long>(masks.size()));
+                    masks.resize(masks.size() + words, 0);
+                    for (const int to: successors) {
+                        set_bit(masks.data() + cell_masks.back(), to);
+                    }
+                } else {
+                    cell_masks.push_back(NO_MASK);
+                    targets.insert(targets.end(), successors.begin(), successors.end());
+                }
+                cell_offsets.push_back(targets.size());
+            }
+        }
+
+        for (int b = 0; b < 256; ++b) {
+            byte_ids[b] = nfa.symbol_id(static_cast<unsigned char>(b));
+        }
+
+        if (is_small()) build_byte_tables();
+    }
+
+    [[nodiscard]] int state_count() const { return states; }
+
+    [[nodiscard]] int symbol_count() const { return symbols; }
+
+    // Number of 64 bit words in a state set.
+    [[nodiscard]] size_t word_count() const { return words; }
+
+    [[nodiscard]] bool is_small() const { return states <= SMALL_STATE_LIMIT; }
+
+    [[nodiscard]] int symbol_id(unsigned char c) const { return byte_ids[c]; }
+
+    [[nodiscard]] const std::vector<uint64_t> &start_set() const { return start; }
+
+    [[nodiscard]] const std::vector<uint64_t> &accept_set() const { return accept; }
+
+    [[nodiscard]] bool all_in_alphabet(std::string_view input) const {
+        return std::all_of(input.begin(), input.end(),
+                           [this](char c) { return byte_ids[static_cast<unsigned char>(c)] != NO_SYMBOL; });
+    }
+
+    // Single word step for machines with at most 64 states.
+    [[nodiscard]] uint64_t step_small(uint64_t current, int symbol) const {
+        const uint64_t *table = byte_tables.data() + static_cast<size_t>(symbol) * 8 * 256;
+        uint64_t next{0};
+        for (int chunk = 0; chunk < 8; ++chunk) {
+            next |= table[chunk * 256 + ((current >> (chunk * 8)) & 0xff)];
+        }
+        return next;
+    }
+
+    // General step: next = union of the successor sets of every bit set in
+    // current. Masks are ORed in with a straight word wise loop the compiler
+    // can vectorise. Returns false when the next set is empty.
+    bool step(const uint64_t *current, uint64_t *next, int symbol) const {
+        std::fill(next, next + words, 0);
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t bits = current[w];
+            while (bits) {
+                const int s = static_cast<int>(w * 64) + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                const size_t cell = static_cast<size_t>(s) * symbols + symbol;
+                if (cell_masks[cell] != NO_MASK) {
+                    const uint64_t *mask = masks.data() + cell_masks[cell];
+                    for (size_t i = 0; i < words; ++i) {
+                        next[i] |= mask[i];
+                    }
+                } else {
+                    for (size_t t = cell_offsets[cell]; t < cell_offsets[cell + 1]; ++t) {
+                        set_bit(next, targets[t]);
+                    }
+                }
+            }
+        }
+
+        uint64_t any{0};
+        for (size_t i = 0; i < words; ++i) {
+            any |= next[i];
+        }
+        return any != 0;
+    }
+
+    [[nodiscard]] bool intersects_accept(const uint64_t *set) const {
+        for (size_t i = 0; i < words; ++i) {
+            if (set[i] & accept[i]) return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] bool intersects_accept_sink(const uint64_t *set) const {
+        for (size_t i = 0; i < words; ++i) {
+            if (set[i] & accept_sink[i]) return true;
+        }
+        return false;
+    }
+
+private:
+    int states;
+    int symbols;
+    size_t words;
+    std::vector<uint64_t> start;
+    std::vector<uint64_t> accept;
+    std::vector<uint64_t> accept_sink;
+    // Successor set of cell state * symbols + symbol: where cell_masks holds
+    // NO_MASK, the states targets[cell_offsets[cell], cell_offsets[cell + 1]),
+    // otherwise the mask starting at masks[cell_masks[cell]]
+    static constexpr long NO_MASK{-1};
+    std::vector<size_t> cell_offsets{};
+    std::vector<long> cell_masks{};
+    std::vector<int> targets{};
+    std::vector<uint64_t> masks{};
+    std::vector<uint64_t> byte_tables{};
+    int byte_ids[256]{};
+
+    static void set_bit(uint64_t *set, int bit) { set[bit / 64] |= uint64_t{1} << (bit % 64); }
+
+    // Successor set of a state as a single word, for machines with at most 64 states
+    [[nodiscard]] uint64_t small_successors(int symbol, int state) const {
+        const size_t cell = static_cast<size_t>(state) * symbols + symbol;
+        if (cell_masks[cell] != NO_MASK) return masks[cell_masks[cell]];
+        uint64_t set{0};
+        for (size_t t = cell_offsets[cell]; t < cell_offsets[cell + 1]; ++t) {
+            set |= uint64_t{1} << targets[t];
+        }
+        return set;
+    }
+
+    void build_byte_tables() {
+        byte_tables.assign(static_cast<size_t>(symbols) * 8 * 256, 0);
+        for (int symbol = 0; symbol < symbols; ++symbol) {
+            uint64_t *table = byte_tables.data() + static_cast<size_t>(symbol) * 8 * 256;
+            for (int chunk = 0; chunk < 8; ++chunk) {
+                for (int value = 1; value < 256; ++value) {
+                    // Reuse the entry without the lowest bit and add that bit's mask
+                    const int low = __builtin_ctz(value);
+                    const int s = chunk * 8 + low;
+                    uint64_t mask = s < states ? small_successors(symbol, s) : 0;
+                    table[chunk * 256 + value] = table[chunk * 256 + (value & (value - 1))] | mask;
+                }
+            }
+        }
+    }
+};
+
+#endif
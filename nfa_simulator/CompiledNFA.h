@@ -0,0 +1,215 @@
+#ifndef COMPILED_NFA_H
+#define COMPILED_NFA_H
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "EpsilonClosures.h"
+
+#define EPSILON_ID (-1)
+#define NO_SYMBOL (-1)
+
+// Read-only, array based form of an NFA. Input symbols are single bytes that
+// map straight to a dense symbol id, and every state has one successor slice
+// per symbol stored back to back (CSR layout). Successor slices are already
+// epsilon closed, so stepping a state set never has to look at epsilon
+// transitions again.
+//
+// States from which no accept state can be reached are dead and are left
+// out of every successor slice (and of the start set), so an active set that
+// can no longer accept shrinks to empty and the run can stop right away.
+// States that accept whatever follows are marked as accept sinks.
+class CompiledNFA {
+public:
+    struct Arc {
+        int from;
+        int symbol; // byte value, or EPSILON_ID
+        int to;
+    };
+
+    // A contiguous run of state ids inside one of the CSR arrays.
+    struct StateRange {
+        const int *first;
+        const int *last;
+
+        [[nodiscard]] const int *begin() const { return first; }
+        [[nodiscard]] const int *end() const { return last; }
+        [[nodiscard]] bool empty() const { return first == last; }
+    };
+
+    // Every arc must have from and to in [0, number_of_states).
+    CompiledNFA(int number_of_states, const std::vector<Arc> &arcs, const std::vector<bool> &accept_states)
+            : states{number_of_states}, accepting(accept_states) {
+        accepting.resize(states, false);
+        symbol_ids.fill(NO_SYMBOL);
+        for (const Arc &arc: arcs) {
+            if (arc.symbol != EPSILON_ID && symbol_ids[arc.symbol] == NO_SYMBOL) {
+                symbol_ids[arc.symbol] = static_cast<int>(symbol_bytes.size());
+                symbol_bytes.push_back(static_cast<unsigned char>(arc.symbol));
+            }
+        }
+
+        build_closures(arcs);
+        find_live_states(arcs);
+        build_successors(arcs);
+        find_accept_sinks();
+
+        if (states > 0) {
+            for (const int s: closure(0)) {
+                if (live[s]) start.push_back(s);
+            }
+        }
+    }
+
+    [[nodiscard]] int state_count() const { return states; }
+
+    [[nodiscard]] int symbol_count() const { return static_cast<int>(symbol_bytes.size()); }
+
+    // Dense id of an input byte, or NO_SYMBOL when the byte is not in the alphabet.
+    [[nodiscard]] int symbol_id(unsigned char c) const { return symbol_ids[c]; }
+
+    [[nodiscard]] bool is_accept_state(int state) const { return accepting[state]; }
+
+    // True if every string over the alphabet is accepted from `state`. Once
+    // such a state is active the only way left to reject is a character that
+    // is not in the alphabet at all.
+    [[nodiscard]] bool is_accept_sink(int state) const { return accept_sink[state]; }
+
+    // The epsilon closure of the start state.
+    [[nodiscard]] const std::vector<int> &start_states() const { return start; }
+
+    // All states reachable from `state` through epsilon transitions, including itself.
+    [[nodiscard]] StateRange closure(int state) const {
+        return {closure_targets.data() + closure_offsets[state],
+                closure_targets.data() + closure_offsets[state + 1]};
+    }
+
+    // Epsilon closed set of states reached from `state` on symbol id `symbol`.
+    [[nodiscard]] StateRange successors(int state, int symbol) const {
+        const size_t cell = static_cast<size_t>(state) * symbol_bytes.size() + symbol;
+        return {successor_targets.data() + successor_offsets[cell],
+                successor_targets.data() + successor_offsets[cell + 1]};
+    }
+
+private:
+    int states;
+    std::vector<bool> accepting;
+    std::vector<bool> live{};
+    std::vector<bool> accept_sink{};
+    std::array<int, 256> symbol_ids{};
+    std::vector<unsigned char> symbol_bytes{};
+    std::vector<int> start{};
+
+    std::vector<int> closure_offsets{};
+    std::vector<int> closure_targets{};
+    std::vector<int> successor_offsets{};
+    std::vector<int> successor_targets{};
+
+    void build_closures(const std::vector<Arc> &arcs) {
+        std::vector<std::vector<int>> epsilon_edges(states);
+        for (const Arc &arc: arcs) {
+            if (arc.symbol == EPSILON_ID) {
+                epsilon_edges[arc.from].push_back(arc.to);
+            }
+        }
+
+        compute_epsilon_closures(states, epsilon_edges, closure_offsets, closure_targets);
+    }
+
+    void build_successors(const std::vector<Arc> &arcs) {
+        const size_t symbols = symbol_bytes.size();
+        const size_t cells = static_cast<size_t>(states) * symbols;
+        auto cell_of = [&](const Arc &arc) {
+            return static_cast<size_t>(arc.from) * symbols + symbol_ids[arc.symbol];
+        };
+
+        // Direct (not yet closed) targets grouped by cell with a counting
+        // sort, so the grouping costs one int per cell rather than a vector
+        std::vector<int> direct_offsets(cells + 1, 0);
+        for (const Arc &arc: arcs) {
+            if (arc.symbol != EPSILON_ID) ++direct_offsets[cell_of(arc)];
+        }
+        for (size_t cell = 0; cell < cells; ++cell) {
+            direct_offsets[cell + 1] += direct_offsets[cell];
+        }
+        std::vector<int> direct_targets(direct_offsets[cells]);
+        for (const Arc &arc: arcs) {
+            if (arc.symbol != EPSILON_ID) direct_targets[--direct_offsets[cell_of(arc)]] = arc.to;
+        }
+
+        std::vector<size_t> visited(states, 0);
+        size_t generation{0};
+        successor_offsets.reserve(cells + 1);
+        successor_offsets.push_back(0);
+        for (size_t cell = 0; cell < cells; ++cell) {
+            ++generation;
+            const size_t first = successor_targets.size();
+            for (int i = direct_offsets[cell]; i < direct_offsets[cell + 1]; ++i) {
+                const int to{direct_targets[i]};
+                for (const int s: closure(to)) {
+                    if (live[s] && visited[s] != generation) {
+                        visited[s] = generation;
+                        successor_targets.push_back(s);
+                    }
+                }
+            }
+            std::sort(successor_targets.begin() + static_cast<long>(first), successor_targets.end());
+            successor_offsets.push_back(static_cast<int>(successor_targets.size()));
+        }
+    }
+
+    // Co-reachability: walk the reversed transition graph from the accept states.
+    void find_live_states(const std::vector<Arc> &arcs) {
+        std::vector<std::vector<int>> reversed(states);
+        for (const Arc &arc: arcs) {
+            reversed[arc.to].push_back(arc.from);
+        }
+
+        live.assign(states, false);
+        std::vector<int> stack{};
+        for (int s = 0; s < states; ++s) {
+            if (accepting[s]) {
+                live[s] = true;
+                stack.push_back(s);
+            }
+        }
+        while (!stack.empty()) {
+            const int s = stack.back();
+            stack.pop_back();
+            for (const int from: reversed[s]) {
+                if (!live[from]) {
+                    live[from] = true;
+                    stack.push_back(from);
+                }
+            }
+        }
+    }
+
+    // Greatest fixed point: start from all accept states and drop any state
+    // that has a symbol without a successor that is still a candidate.
+    void find_accept_sinks() {
+        accept_sink = accepting;
+        if (symbol_bytes.empty()) return;
+
+        bool changed{true};
+        while (changed) {
+            changed = false;
+            for (int s = 0; s < states; ++s) {
+                if (!accept_sink[s]) continue;
+                for (int symbol = 0; symbol < symbol_count(); ++symbol) {
+                    const StateRange next = successors(s, symbol);
+                    if (std::none_of(next.begin(), next.end(), [this](int t) { return accept_sink[t]; })) {
+                        accept_sink[s] = false;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+};
+
+#endif
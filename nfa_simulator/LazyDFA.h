@@ -0,0 +1,179 @@
+#ifndef LAZY_DFA_H
+#define LAZY_DFA_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "BitParallelNFA.h"
+
+#define UNKNOWN_STATE (-1)
+#define DEAD_STATE (-2)
+#define ACCEPT_SINK_STATE (-3)
+
+// DFA built on demand from a BitParallelNFA (subset construction done one
+// transition at a time). Every distinct NFA state set seen gets a DFA state
+// id, and each (DFA state, symbol) transition is computed once and then
+// read from a table. Once the cache outgrows its memory budget every cached
+// state is thrown away and only the state being added is kept; the rest,
+// the start state included, are rebuilt on demand as later transitions need
+// them, so memory stays bounded on inputs that keep producing new state sets.
+//
+// Two state sets never get a cache entry: the empty set (DEAD_STATE, reject
+// now) and any set holding an accept sink (ACCEPT_SINK_STATE, accept as long
+// as the rest of the input is in the alphabet). Both end the run early.
+class LazyDFA {
+public:
+    static constexpr size_t DEFAULT_MEMORY_LIMIT{8 * 1024 * 1024};
+
+    explicit LazyDFA(const BitParallelNFA &nfa, size_t memory_limit = DEFAULT_MEMORY_LIMIT)
+            : nfa{nfa},
+              words{nfa.word_count()},
+              symbols{static_cast<size_t>(nfa.symbol_count())},
+              memory_limit{memory_limit},
+              scratch(nfa.word_count()) {
+        flush();
+    }
+
+    [[nodiscard]] bool accepts(std::string_view input) {
+        if (start_id == UNKNOWN_STATE) {
+            start_id = find_or_add(nfa.start_set().data());
+        }
+
+        if (start_id == ACCEPT_SINK_STATE) {
+            return nfa.all_in_alphabet(input);
+        }
+
+        int state{start_id};
+        for (size_t i = 0; i < input.size(); ++i) {
+            const int symbol = nfa.symbol_id(static_cast<unsigned char>(input[i]));
+            if (symbol == NO_SYMBOL) {
+                return false;
+            }
+
+            int next = transitions[static_cast<size_t>(state) * symbols + symbol];
+            if (next == UNKNOWN_STATE) {
+                next = compute_transition(state, symbol);
+            }
+            if (next < 0) {
+                return next == ACCEPT_SINK_STATE && nfa.all_in_alphabet(input.substr(i + 1));
+            }
+            state = next;
+        }
+
+        return accepting[state];
+    }
+
+private:
+    static constexpr size_t INITIAL_SLOTS{64};
+
+    const BitParallelNFA &nfa;
+    size_t words;
+    size_t symbols;
+    size_t memory_limit;
+
+    // DFA state i owns words [i * words, (i + 1) * words) of state_sets and
+    // symbols entries starting at i * symbols in transitions
+    std::vector<uint64_t> state_sets{};
+    std::vector<int> transitions{};
+    std::vector<bool> accepting{};
+    // Open addressing hash table of DFA state ids, keyed by their state set
+    std::vector<int> slots{};
+
+    std::vector<uint64_t> scratch;
+    int start_id{UNKNOWN_STATE};
+    size_t flushes{0};
+
+    [[nodiscard]] size_t memory_used() const {
+        return state_sets.size() * sizeof(uint64_t) + transitions.size() * sizeof(int) +
+               accepting.size() / 8 + slots.size() * sizeof(int);
+    }
+
+    void flush() {
+        state_sets.clear();
+        transitions.clear();
+        accepting.clear();
+        slots.assign(INITIAL_SLOTS, UNKNOWN_STATE);
+        start_id = UNKNOWN_STATE;
+    }
+
+    [[nodiscard]] size_t hash(const uint64_t *set) const {
+        uint64_t h{0xcbf29ce484222325ULL};
+        for (size_t i = 0; i < words; ++i) {
+            h = (h ^ set[i]) * 0x100000001b3ULL;
+            h ^= h >> 29;
+        }
+        return static_cast<size_t>(h);
+    }
+
+    [[nodiscard]] bool same_set(int id, const uint64_t *set) const {
+        const uint64_t *stored = state_sets.data() + static_cast<size_t>(id) * words;
+        for (size_t i = 0; i < words; ++i) {
+            if (stored[i] != set[i]) return false;
+        }
+        return true;
+    }
+
+    void insert_slot(int id) {
+        const size_t mask = slots.size() - 1;
+        size_t slot = hash(state_sets.data() + static_cast<size_t>(id) * words) & mask;
+        while (slots[slot] != UNKNOWN_STATE) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id;
+    }
+
+    int find_or_add(const uint64_t *set) {
+        if (nfa.intersects_accept_sink(set)) {
+            return ACCEPT_SINK_STATE;
+        }
+
+        const size_t mask = slots.size() - 1;
+        size_t slot = hash(set) & mask;
+        while (slots[slot] != UNKNOWN_STATE) {
+            if (same_set(slots[slot], set)) return slots[slot];
+            slot = (slot + 1) & mask;
+        }
+
+        const size_t new_state_bytes = words * sizeof(uint64_t) + symbols * sizeof(int);
+        if (!accepting.empty() && memory_used() + new_state_bytes > memory_limit) {
+            // The caller only keeps the id we return, so the cache can be
+            // dropped entirely before the new state is added
+            ++flushes;
+            flush();
+            return find_or_add(set);
+        }
+
+        const int id{static_cast<int>(accepting.size())};
+        state_sets.insert(state_sets.end(), set, set + words);
+        transitions.resize(transitions.size() + symbols, UNKNOWN_STATE);
+        accepting.push_back(nfa.intersects_accept(set));
+
+        if (accepting.size() * 2 > slots.size()) {
+            slots.assign(slots.size() * 2, UNKNOWN_STATE);
+            for (int i = 0; i < static_cast<int>(accepting.size()); ++i) {
+                insert_slot(i);
+            }
+        } else {
+            insert_slot(id);
+        }
+        return id;
+    }
+
+    int compute_transition(int state, int symbol) {
+        if (!nfa.step(state_sets.data() + static_cast<size_t>(state) * words, scratch.data(), symbol)) {
+            transitions[static_cast<size_t>(state) * symbols + symbol] = DEAD_STATE;
+            return DEAD_STATE;
+        }
+
+        const size_t flushes_before{flushes};
+        const int next = find_or_add(scratch.data());
+        // After a flush `state` no longer exists, so there is nothing to record
+        if (flushes == flushes_before) {
+            transitions[static_cast<size_t>(state) * symbols + symbol] = next;
+        }
+        return next;
+    }
+};
+
+#endif
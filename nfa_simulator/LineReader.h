@@ -0,0 +1,137 @@
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define READ_CHUNK_SIZE (1 << 20)
+
+// Reads newline separated lines from a file descriptor without copying them
+// into strings. Regular files are memory mapped and every line is a view
+// into the mapping. Pipes and terminals are read in chunks into a buffer
+// that only holds the lines not handed out yet, so memory does not grow
+// with the size of the input.
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd{fd} {
+        struct stat info{};
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                madvise(mapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+                mapped = static_cast<const char *>(mapping);
+                mapped_size = static_cast<size_t>(info.st_size);
+                // Share the position with anything that read the descriptor before us
+                const off_t offset = lseek(fd, 0, SEEK_CUR);
+                begin = offset > 0 ? static_cast<size_t>(offset) : 0;
+                end = mapped_size;
+                at_eof = true;
+            }
+        }
+    }
+
+    LineReader(const LineReader &) = delete;
+
+    LineReader &operator=(const LineReader &) = delete;
+
+    ~LineReader() {
+        if (mapped) munmap(const_cast<char *>(mapped), mapped_size);
+    }
+
+    // Read the next line without its newline. Returns false at end of input.
+    // The view stays valid until the next call on this reader.
+    bool next_line(std::string_view &line) {
+        return find_line(line) || (refill() && find_line(line));
+    }
+
+    // Convenience for headers and counts that are kept around.
+    bool next_line(std::string &line) {
+        std::string_view view{};
+        if (!next_line(view)) return false;
+        line.assign(view.begin(), view.end());
+        return true;
+    }
+
+    // Collect up to max_lines lines. All views in `lines` stay valid until
+    // the next call on this reader. Returns the number of lines read.
+    size_t next_batch(std::vector<std::string_view> &lines, size_t max_lines) {
+        lines.clear();
+        std::string_view line{};
+        while (lines.size() < max_lines && find_line(line)) {
+            lines.push_back(line);
+        }
+        // Refilling moves the buffer, so only do it before handing out anything
+        if (lines.empty() && max_lines > 0 && refill()) {
+            while (lines.size() < max_lines && find_line(line)) {
+                lines.push_back(line);
+            }
+        }
+        return lines.size();
+    }
+
+private:
+    int fd;
+    const char *mapped{nullptr};
+    size_t mapped_size{0};
+    std::vector<char> buffer{};
+    // Unread bytes are [begin, end) of either the mapping or the buffer
+    size_t begin{0};
+    size_t end{0};
+    bool at_eof{false};
+
+    [[nodiscard]] const char *data() const { return mapped ? mapped : buffer.data(); }
+
+    bool find_line(std::string_view &line) {
+        if (begin >= end) return false;
+
+        const char *first = data() + begin;
+        const auto *newline = static_cast<const char *>(std::memchr(first, '\n', end - begin));
+        if (newline) {
+            line = std::string_view{first, static_cast<size_t>(newline - first)};
+            begin += line.size() + 1;
+            return true;
+        }
+        if (at_eof) {
+            // Last line without a trailing newline
+            line = std::string_view{first, end - begin};
+            begin = end;
+            return true;
+        }
+        return false;
+    }
+
+    // Move the partial line to the front of the buffer and read more data
+    // until at least one full line is available. Returns false once there is
+    // nothing left to read.
+    bool refill() {
+        if (mapped || at_eof) return false;
+
+        const size_t pending = end - begin;
+        if (pending > 0) std::memmove(buffer.data(), buffer.data() + begin, pending);
+        begin = 0;
+        end = pending;
+
+        while (true) {
+            if (buffer.size() - end < READ_CHUNK_SIZE / 2) {
+                buffer.resize(std::max<size_t>(READ_CHUNK_SIZE, buffer.size() * 2));
+            }
+            const ssize_t count = read(fd, buffer.data() + end, buffer.size() - end);
+            if (count <= 0) {
+                at_eof = true;
+                return end > begin;
+            }
+            const bool has_newline = std::memchr(buffer.data() + end, '\n', static_cast<size_t>(count)) != nullptr;
+            end += static_cast<size_t>(count);
+            if (has_newline) return true;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef PRODUCT_AUTOMATON_H
+#define PRODUCT_AUTOMATON_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "BitParallelNFA.h"
+
+enum class ProductOperation {
+    INTERSECTION,
+    UNION,
+    DIFFERENCE
+};
+
+// Result of an emptiness check. When the language is not empty, witness is
+// one of the shortest strings in it.
+struct EmptinessResult {
+    bool empty{true};
+    std::string witness{};
+    // Number of product states visited before the answer was known
+    size_t explored{0};
+};
+
+// Boolean combination of two NFAs, built on the fly. A product state is the
+// pair of state sets the two machines are in, so nothing is determinised or
+// materialised up front: membership runs both machines in lock step, and
+// the emptiness check only visits product states reachable from the start,
+// skipping pairs that can no longer lead to acceptance under the chosen
+// operation.
+//
+// A byte outside one machine's alphabet empties that machine's set, which
+// matches how each machine treats such strings on its own.
+class ProductAutomaton {
+public:
+    ProductAutomaton(const BitParallelNFA &left, const BitParallelNFA &right, ProductOperation operation)
+            : left{left}, right{right}, operation{operation},
+              left_current(left.word_count()), left_next(left.word_count()),
+              right_current(right.word_count()), right_next(right.word_count()) {
+        for (int b = 0; b < 256; ++b) {
+            const auto c = static_cast<unsigned char>(b);
+            if (left.symbol_id(c) != NO_SYMBOL || right.symbol_id(c) != NO_SYMBOL) {
+                alphabet.push_back(c);
+            }
+        }
+    }
+
+    [[nodiscard]] bool accepts(std::string_view input) {
+        left_current = left.start_set();
+        right_current = right.start_set();
+        bool left_alive{any(left_current)};
+        bool right_alive{any(right_current)};
+
+        for (const char c: input) {
+            if (!can_accept(left_alive, right_alive)) {
+                return false;
+            }
+            left_alive = left_alive && advance(left, left_current, left_next, static_cast<unsigned char>(c));
+            right_alive = right_alive && advance(right, right_current, right_next, static_cast<unsigned char>(c));
+        }
+
+        return combine(left_alive && left.intersects_accept(left_current.data()),
+                       right_alive && right.intersects_accept(right_current.data()));
+    }
+
+    // Breadth first search over the reachable product states for an
+    // accepting one, so a witness found is one of the shortest.
+    [[nodiscard]] EmptinessResult check_empty() const {
+        struct Node {
+            int parent;
+            unsigned char symbol;
+        };
+
+        const size_t left_words{left.word_count()};
+        const size_t right_words{right.word_count()};
+        std::vector<Node> nodes{};
+        std::vector<std::vector<uint64_t>> pairs{};
+        std::unordered_map<std::string, int> visited{};
+        std::deque<int> queue{};
+
+        auto key_of = [](const std::vector<uint64_t> &pair) {
+            return std::string{reinterpret_cast<const char *>(pair.data()), pair.size() * sizeof(uint64_t)};
+        };
+        auto is_accepting = [&](const std::vector<uint64_t> &pair) {
+            return combine(left.intersects_accept(pair.data()), right.intersects_accept(pair.data() + left_words));
+        };
+        auto witness = [&](int node) {
+            EmptinessResult result{false, {}, nodes.size()};
+            for (int n = node; nodes[n].parent != -1; n = nodes[n].parent) {
+                result.witness.insert(result.witness.begin(), static_cast<char>(nodes[n].symbol));
+            }
+            return result;
+        };
+
+        std::vector<uint64_t> start{left.start_set()};
+        start.insert(start.end(), right.start_set().begin(), right.start_set().end());
+        visited.emplace(key_of(start), 0);
+        nodes.push_back({-1, 0});
+        pairs.push_back(start);
+        queue.push_back(0);
+        if (is_accepting(start)) return witness(0);
+
+        std::vector<uint64_t> pair(left_words + right_words);
+        std::vector<uint64_t> left_set(left_words);
+        std::vector<uint64_t> right_set(right_words);
+        while (!queue.empty()) {
+            const int current{queue.front()};
+            queue.pop_front();
+
+            for (const unsigned char c: alphabet) {
+                const bool left_alive{step_from(left, pairs[current].data(), left_set, c)};
+                const bool right_alive{step_from(right, pairs[current].data() + left_words, right_set, c)};
+                if (!can_accept(left_alive, right_alive)) continue;
+
+                std::copy(left_set.begin(), left_set.end(), pair.begin());
+                std::copy(right_set.begin(), right_set.end(), pair.begin() + static_cast<long>(left_words));
+                const int id{static_cast<int>(nodes.size())};
+                if (!visited.emplace(key_of(pair), id).second) continue;
+
+                nodes.push_back({current, c});
+                pairs.push_back(pair);
+                if (is_accepting(pair)) return witness(id);
+                queue.push_back(id);
+            }
+        }
+
+        return {true, {}, nodes.size()};
+    }
+
+private:
+    const BitParallelNFA &left;
+    const BitParallelNFA &right;
+    ProductOperation operation;
+    std::vector<unsigned char> alphabet{};
+    std::vector<uint64_t> left_current;
+    std::vector<uint64_t> left_next;
+    std::vector<uint64_t> right_current;
+    std::vector<uint64_t> right_next;
+
+    [[nodiscard]] bool combine(bool left_accepts, bool right_accepts) const {
+        switch (operation) {
+            case ProductOperation::INTERSECTION:
+                return left_accepts && right_accepts;
+            case ProductOperation::UNION:
+                return left_accepts || right_accepts;
+            case ProductOperation::DIFFERENCE:
+                return left_accepts && !right_accepts;
+        }
+        return false;
+    }
+
+    // Whether a product state whose sides are (non-)empty can still reach
+    // acceptance. An empty side never accepts again.
+    [[nodiscard]] bool can_accept(bool left_alive, bool right_alive) const {
+        switch (operation) {
+            case ProductOperation::INTERSECTION:
+                return left_alive && right_alive;
+            case ProductOperation::UNION:
+                return left_alive || right_alive;
+            case ProductOperation::DIFFERENCE:
+                return left_alive;
+        }
+        return false;
+    }
+
+    static bool any(const std::vector<uint64_t> &set) {
+        for (const uint64_t word: set) {
+            if (word) return true;
+        }
+        return false;
+    }
+
+    static bool step_from(const BitParallelNFA &nfa, const uint64_t *current, std::vector<uint64_t> &next,
+                          unsigned char c) {
+        const int symbol = nfa.symbol_id(c);
+        if (symbol == NO_SYMBOL) {
+            std::fill(next.begin(), next.end(), 0);
+            return false;
+        }
+        return nfa.step(current, next.data(), symbol);
+    }
+
+    static bool advance(const BitParallelNFA &nfa, std::vector<uint64_t> &current, std::vector<uint64_t> &next,
+                        unsigned char c) {
+        const bool alive{step_from(nfa, current.data(), next, c)};
+        std::swap(current, next);
+        return alive;
+    }
+};
+
+#endif
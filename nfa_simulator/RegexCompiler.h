@@ -0,0 +1,460 @@
+#ifndef REGEX_COMPILER_H
+#define REGEX_COMPILER_H
+
+#include <algorithm>
+#include <bitset>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "CompiledNFA.h"
+
+// Largest count allowed in {n}, {n,} and {n,m}
+#define REGEX_MAX_REPEAT 1000
+// Largest NFA a pattern may expand to, mostly to stop nested bounded
+// repetition from blowing up. CompiledNFA and BitParallelNFA keep about 24
+// bytes for every (state, byte) pair, so the states times the bytes the
+// pattern reads are capped as well, which holds them to about a gigabyte.
+#define REGEX_MAX_STATES (1 << 20)
+#define REGEX_MAX_CELLS (1 << 25)
+#define REGEX_UNBOUNDED (-1)
+
+// NFA built from a regular expression, in the form CompiledNFA is built
+// from. State 0 is the start state. error is empty on success.
+struct RegexNFA {
+    int states{0};
+    std::vector<CompiledNFA::Arc> arcs{};
+    std::vector<bool> accept{};
+    std::string error{};
+
+    [[nodiscard]] CompiledNFA compile() const { return {states, arcs, accept}; }
+};
+
+// Compiles a byte oriented regular expression into an NFA with Thompson's
+// construction. A pattern must match the whole input. Supported syntax:
+//
+//   a  \.  \n \t \r \f \v \xHH     literal bytes
+//   .                              any byte but newline
+//   [abc] [a-z] [^...]             character classes
+//   \d \w \s  \D \W \S             digit, word and space classes
+//   ab  a|b  (a)  (?:a)            concatenation, alternation, grouping
+//   a*  a+  a?  a{n}  a{n,}  a{n,m}
+//   a*?  a+?  a??  a{n}? ...        lazy forms, same as the greedy ones
+//
+// A '{' that does not start a valid bound is a literal. Bounded repetition
+// copies the repeated part, so the NFA grows with the counts.
+class RegexCompiler {
+public:
+    explicit RegexCompiler(std::string_view pattern) : pattern{pattern} {}
+
+    [[nodiscard]] RegexNFA compile() {
+        RegexNFA nfa{};
+        const int root{parse_alternation()};
+        if (error.empty() && position < pattern.size()) {
+            fail("unmatched ')'");
+        }
+        if (!error.empty()) {
+            nfa.error = error;
+            return nfa;
+        }
+
+        const int start{new_state(nfa)};
+        const Fragment body{emit(root, nfa)};
+        if (!nfa.error.empty()) return nfa;
+        nfa.arcs.push_back({start, EPSILON_ID, body.start});
+        nfa.accept.assign(nfa.states, false);
+        nfa.accept[body.end] = true;
+        return nfa;
+    }
+
+private:
+    using ByteSet = std::bitset<256>;
+
+    struct Node {
+        enum Kind {
+            BYTES,
+            CONCAT,
+            ALTERNATE,
+            REPEAT
+        } kind;
+        ByteSet bytes{};
+        std::vector<int> children{};
+        int min{0};
+        int max{0};
+    };
+
+    // Piece of NFA with one entry and one exit state
+    struct Fragment {
+        int start;
+        int end;
+    };
+
+    std::string_view pattern;
+    size_t position{0};
+    std::string error{};
+    std::vector<Node> nodes{};
+    // bytes any arc emitted so far reads
+    ByteSet alphabet{};
+
+    void fail(const std::string &message) {
+        if (error.empty()) {
+            error = message + " at offset " + std::to_string(position);
+        }
+    }
+
+    [[nodiscard]] bool at_end() const { return position >= pattern.size(); }
+
+    [[nodiscard]] char peek() const { return pattern[position]; }
+
+    int add_node(Node node) {
+        nodes.push_back(std::move(node));
+        return static_cast<int>(nodes.size()) - 1;
+    }
+
+    int parse_alternation() {
+        std::vector<int> branches{parse_concatenation()};
+        while (error.empty() && !at_end() && peek() == '|') {
+            ++position;
+            branches.push_back(parse_concatenation());
+        }
+        if (branches.size() == 1) return branches[0];
+        return add_node({Node::ALTERNATE, {}, branches});
+    }
+
+    int parse_concatenation() {
+        std::vector<int> items{};
+        while (error.empty() && !at_end() && peek() != '|' && peek() != ')') {
+            items.push_back(parse_repetition());
+        }
+        if (items.size() == 1) return items[0];
+        return add_node({Node::CONCAT, {}, items});
+    }
+
+    // An atom and at most one quantifier. A '?' right after the quantifier
+    // makes it lazy, which does not change what a whole line matches, so it
+    // is skipped; any other quantifier after it is an error, as in PCRE.
+    int parse_repetition() {
+        const int item{parse_atom()};
+        int min;
+        int max;
+        if (!error.empty() || !parse_quantifier(min, max)) return item;
+
+        if (!at_end() && peek() == '?') ++position;
+        int again_min;
+        int again_max;
+        if (error.empty() && parse_quantifier(again_min, again_max)) {
+            fail("multiple repeat");
+        }
+        return add_node({Node::REPEAT, {}, {item}, min, max});
+    }
+
+    // *, +, ? or a bound at the current position. Returns false, leaving the
+    // position alone, when there is none.
+    bool parse_quantifier(int &min, int &max) {
+        if (at_end()) return false;
+        const char c{peek()};
+        if (c == '*' || c == '+' || c == '?') {
+            min = c == '+' ? 1 : 0;
+            max = c == '?' ? 1 : REGEX_UNBOUNDED;
+            ++position;
+            return true;
+        }
+        return c == '{' && parse_bound(min, max);
+    }
+
+    // {n}, {n,} or {n,m}. Leaves position alone and returns false when the
+    // text is not a bound, so the '{' is read as a literal.
+    bool parse_bound(int &min, int &max) {
+        size_t p{position + 1};
+        auto number = [&](int &value) {
+            const size_t first{p};
+            long parsed{0};
+            while (p < pattern.size() && pattern[p] >= '0' && pattern[p] <= '9') {
+                parsed = std::min<long>(parsed * 10 + (pattern[p] - '0'), REGEX_MAX_REPEAT + 1L);
+                ++p;
+            }
+            value = static_cast<int>(parsed);
+            return p > first;
+        };
+
+        if (!number(min)) return false;
+        max = min;
+        if (p < pattern.size() && pattern[p] == ',') {
+            ++p;
+            if (!number(max)) max = REGEX_UNBOUNDED;
+        }
+        if (p >= pattern.size() || pattern[p] != '}') return false;
+        position = p + 1;
+
+        if (min > REGEX_MAX_REPEAT || max > REGEX_MAX_REPEAT) {
+            fail("repetition count over " + std::to_string(REGEX_MAX_REPEAT));
+        } else if (max != REGEX_UNBOUNDED && max < min) {
+            fail("repetition bounds out of order");
+        }
+        return true;
+    }
+
+    int parse_atom() {
+        const char c{peek()};
+        if (c == '*' || c == '+' || c == '?') {
+            fail("nothing to repeat");
+            return -1;
+        }
+
+        ++position;
+        if (c == '(') {
+            if (pattern.substr(position, 2) == "?:") position += 2;
+            const int inner{parse_alternation()};
+            if (error.empty() && (at_end() || peek() != ')')) {
+                fail("missing ')'");
+            }
+            ++position;
+            return inner;
+        }
+
+        ByteSet bytes{};
+        if (c == '[') {
+            parse_class(bytes);
+        } else if (c == '.') {
+            bytes.set();
+            bytes.reset('\n');
+        } else if (c == '\\') {
+            parse_escape(bytes);
+        } else {
+            bytes.set(static_cast<unsigned char>(c));
+        }
+        return add_node({Node::BYTES, bytes});
+    }
+
+    // Body of a [...] class, after the '['. A ']' right after the '[' or
+    // '[^' is a literal.
+    void parse_class(ByteSet &bytes) {
+        bool negated{false};
+        if (!at_end() && peek() == '^') {
+            negated = true;
+            ++position;
+        }
+
+        bool first{true};
+        while (error.empty() && !at_end() && (first || peek() != ']')) {
+            first = false;
+            ByteSet low{};
+            const bool single{parse_class_member(low)};
+            if (single && position + 1 < pattern.size() && peek() == '-' && pattern[position + 1] != ']') {
+                ++position;
+                ByteSet high{};
+                if (!parse_class_member(high)) {
+                    fail("class range ends in a class");
+                    return;
+                }
+                const int from{first_byte(low)};
+                const int to{first_byte(high)};
+                if (from > to) {
+                    fail("class range out of order");
+                    return;
+                }
+                for (int b = from; b <= to; ++b) {
+                    bytes.set(b);
+                }
+            } else {
+                bytes |= low;
+            }
+        }
+        if (error.empty() && at_end()) {
+            fail("missing ']'");
+            return;
+        }
+        ++position;
+
+        if (negated) {
+            bytes.flip();
+            bytes.reset('\n');
+        }
+    }
+
+    // One member of a class. Returns true when it is a single byte, which
+    // can start or end a range.
+    bool parse_class_member(ByteSet &bytes) {
+        const char c{peek()};
+        ++position;
+        if (c != '\\') {
+            bytes.set(static_cast<unsigned char>(c));
+            return true;
+        }
+        parse_escape(bytes);
+        return bytes.count() == 1;
+    }
+
+    // Escape sequence, after the backslash.
+    void parse_escape(ByteSet &bytes) {
+        if (at_end()) {
+            fail("trailing '\\'");
+            return;
+        }
+
+        const char c{peek()};
+        ++position;
+        switch (c) {
+            case 'n':
+                bytes.set('\n');
+                return;
+            case 't':
+                bytes.set('\t');
+                return;
+            case 'r':
+                bytes.set('\r');
+                return;
+            case 'f':
+                bytes.set('\f');
+                return;
+            case 'v':
+                bytes.set('\v');
+                return;
+            case 'd':
+            case 'D':
+                for (int b = '0'; b <= '9'; ++b) bytes.set(b);
+                break;
+            case 'w':
+            case 'W':
+                for (int b = '0'; b <= '9'; ++b) bytes.set(b);
+                for (int b = 'a'; b <= 'z'; ++b) bytes.set(b);
+                for (int b = 'A'; b <= 'Z'; ++b) bytes.set(b);
+                bytes.set('_');
+                break;
+            case 's':
+            case 'S':
+                for (const char space: {' ', '\t', '\n', '\r', '\f', '\v'}) bytes.set(static_cast<unsigned char>(space));
+                break;
+            case 'x': {
+                int value{0};
+                for (int digit = 0; digit < 2; ++digit) {
+                    const int hex{at_end() ? -1 : hex_value(peek())};
+                    if (hex < 0) {
+                        fail("\\x needs two hex digits");
+                        return;
+                    }
+                    value = value * 16 + hex;
+                    ++position;
+                }
+                bytes.set(value);
+                return;
+            }
+            default:
+                if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+                    fail(std::string{"unknown escape \\"} + c);
+                } else {
+                    bytes.set(static_cast<unsigned char>(c));
+                }
+                return;
+        }
+
+        // Upper case class escapes are the complement, never matching newline
+        if (c >= 'A' && c <= 'Z') {
+            bytes.flip();
+            bytes.reset('\n');
+        }
+    }
+
+    static int first_byte(const ByteSet &bytes) {
+        for (int b = 0; b < 256; ++b) {
+            if (bytes[b]) return b;
+        }
+        return -1;
+    }
+
+    static int hex_value(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    int new_state(RegexNFA &nfa) const {
+        const size_t bytes{std::max<size_t>(alphabet.count(), 1)};
+        const int limit{static_cast<int>(std::min<size_t>(REGEX_MAX_STATES, REGEX_MAX_CELLS / bytes))};
+        if (nfa.states >= limit && nfa.error.empty()) {
+            nfa.error = "pattern needs more than " + std::to_string(limit) + " states";
+        }
+        return nfa.states++;
+    }
+
+    static void epsilon(RegexNFA &nfa, int from, int to) { nfa.arcs.push_back({from, EPSILON_ID, to}); }
+
+    // Thompson construction for the subtree at `node`. Called again for
+    // every copy a bounded repetition needs.
+    Fragment emit(int node, RegexNFA &nfa) {
+        if (!nfa.error.empty()) return {0, 0};
+
+        const Node &n = nodes[node];
+        switch (n.kind) {
+            case Node::BYTES: {
+                alphabet |= n.bytes;
+                const Fragment f{new_state(nfa), new_state(nfa)};
+                for (int b = 0; b < 256; ++b) {
+                    if (n.bytes[b]) nfa.arcs.push_back({f.start, b, f.end});
+                }
+                return f;
+            }
+            case Node::CONCAT: {
+                if (n.children.empty()) {
+                    const Fragment f{new_state(nfa), new_state(nfa)};
+                    epsilon(nfa, f.start, f.end);
+                    return f;
+                }
+                const Fragment first{emit(n.children[0], nfa)};
+                int end{first.end};
+                for (size_t i = 1; i < n.children.size(); ++i) {
+                    const Fragment next{emit(n.children[i], nfa)};
+                    epsilon(nfa, end, next.start);
+                    end = next.end;
+                }
+                return {first.start, end};
+            }
+            case Node::ALTERNATE: {
+                const Fragment f{new_state(nfa), new_state(nfa)};
+                for (const int child: n.children) {
+                    const Fragment branch{emit(child, nfa)};
+                    epsilon(nfa, f.start, branch.start);
+                    epsilon(nfa, branch.end, f.end);
+                }
+                return f;
+            }
+            case Node::REPEAT:
+                return emit_repeat(n.children[0], n.min, n.max, nfa);
+        }
+        return {0, 0};
+    }
+
+    // min required copies, then either a looping copy (unbounded) or
+    // max - min optional copies that can each skip to the end.
+    Fragment emit_repeat(int child, int min, int max, RegexNFA &nfa) {
+        const Fragment f{new_state(nfa), new_state(nfa)};
+        int end{f.start};
+        for (int i = 0; i < min; ++i) {
+            const Fragment copy{emit(child, nfa)};
+            epsilon(nfa, end, copy.start);
+            end = copy.end;
+        }
+
+        if (max == REGEX_UNBOUNDED) {
+            const Fragment loop{emit(child, nfa)};
+            epsilon(nfa, end, loop.start);
+            epsilon(nfa, loop.end, loop.start);
+            epsilon(nfa, loop.end, f.end);
+        } else {
+            for (int i = min; i < max && nfa.error.empty(); ++i) {
+                const Fragment copy{emit(child, nfa)};
+                epsilon(nfa, end, copy.start);
+                epsilon(nfa, end, f.end);
+                end = copy.end;
+            }
+        }
+        epsilon(nfa, end, f.end);
+        return f;
+    }
+};
+
+inline RegexNFA compile_regex(std::string_view pattern) { return RegexCompiler{pattern}.compile(); }
+
+#endif
@@ -1,30 +1,24 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <utility>
 #include <vector>
-#include <set>
 #include <map>
+#include <new>
+#include <optional>
+
+#include "AutomatonSearch.h"
+#include "BatchRunner.h"
+#include "BinaryDFA.h"
+#include "BitParallelNFA.h"
+#include "CompiledNFA.h"
+#include "LazyDFA.h"
+#include "LineReader.h"
+#include "ProductAutomaton.h"
+#include "RegexCompiler.h"
 
 #define EPSILON "eps"
-
-bool append_unique(std::vector<int> &v, int val) {
-    for (const auto &i: v) {
-        if (i == val) {
-            return false;
-        }
-    }
-
-    v.push_back(val);
-    return true;
-}
-
-class TransitionPair {
-public:
-    std::string symbol;
-    std::set<int> to;
-
-    explicit TransitionPair(std::string sym) : symbol{std::move(sym)} {}
-};
+#define STREAM_BATCH_LINES (1 << 16)
 
 class NFA {
 public:
@@ -34,18 +28,15 @@ public:
         int to;
     };
 
-    std::set<std::string> alphabet;
-    std::map<int, std::vector<TransitionPair>> transition_table;
-    std::map<int, std::set<int>> epsilon_expansions;
+    int states{};
+    std::vector<Transition> transitions;
     std::map<int, bool> acceptStates;
 
-    NFA(std::set<std::string> alphabet,
-        std::map<int, std::vector<TransitionPair>> transitionTable,
-        std::map<int, std::set<int>> epsilon_expansions,
+    NFA(int states,
+        std::vector<Transition> transitions,
         std::map<int, bool> acceptStates)
-            : alphabet{std::move(alphabet)},
-              transition_table{std::move(transitionTable)},
-              epsilon_expansions{std::move(epsilon_expansions)},
+            : states{states},
+              transitions{std::move(transitions)},
               acceptStates{std::move(acceptStates)} {}
 
     static NFA::Transition split_transition_input(std::string transitionString) {
@@ -64,164 +55,52 @@ public:
         return {stoi(pieces[0]), pieces[1], stoi(pieces[2])};
     }
 
-    [[nodiscard]] bool is_accept_state(const int state) const {
-        return acceptStates.at(state);
-    }
-};
-
-std::map<int, std::set<int>>
-populate_epsilon_transitions_map(const std::vector<NFA::Transition> &transitions, const int number_of_states) {
-    std::map<int, std::set<int>> epsilon_expansions_map{};
-    for (int i = 0; i < number_of_states; ++i) {
-        epsilon_expansions_map[i] = {};
-    }
-
-    for (const NFA::Transition &t: transitions) {
-        if (t.symbol == EPSILON) {
-            epsilon_expansions_map.at(t.from).insert(t.to);
-        }
-    }
-
-    return epsilon_expansions_map;
-}
-
-std::vector<int> get_epsilon_expansion_states(
-        const NFA::Transition &transition,
-        const std::map<int, std::set<int>> &epsilon_expansions_map) {
-    std::vector<int> states_to_expand{transition.from, transition.to};
-    int i{0};
-    while (i < states_to_expand.size()) {
-        int current_state_to_expand = states_to_expand[i];
-
-        // Debugging
-        if (current_state_to_expand > epsilon_expansions_map.size()) return states_to_expand;
-
-        std::set<int> states = epsilon_expansions_map.at(current_state_to_expand);
-        for (int s: states) {
-            append_unique(states_to_expand, s);
-        }
-        i++;
-    }
-
-    return states_to_expand;
-}
-
-std::pair<std::map<int, std::vector<TransitionPair>>, std::map<int, std::set<int>>>
-construct_transitions_table_for_alphabet(int number_of_states,
-                                         const std::set<std::string> &alphabet,
-                                         const std::vector<NFA::Transition> &transitions) {
-    std::map<int, std::vector<TransitionPair>> transitions_table{};
-    std::map<int, std::set<int>> epsilon_expansion_transitions_map{
-            populate_epsilon_transitions_map(transitions, number_of_states)};
-
-    // Map state => the set of states the machine would expand to be in upon
-    // reaching this state.
-    std::map<int, std::set<int>> epsilon_expansions{};
-    for (int i = 0; i < number_of_states; ++i) {
-        epsilon_expansions[i] = {};
-    }
-
-    // Initialize table cells for all states and symbols
-    for (int i = 0; i < number_of_states; ++i) {
-        for (const auto &symbol: alphabet) {
-            TransitionPair p{symbol};
-            transitions_table[i].push_back(p);
-        }
-    }
-
-    // Populate the epsilon expansions first
-    for (const NFA::Transition &transition: transitions) {
-        if (transition.symbol != EPSILON) continue;
-
-        std::set<int> &item = epsilon_expansions.at(transition.from);
-        std::vector<int> states_to_expand{get_epsilon_expansion_states(
-                transition,
-                epsilon_expansion_transitions_map)};
-
-        for (const int state: states_to_expand) {
-            item.insert(state);
-        }
-    }
-
-    for (int i = 0; i < number_of_states; ++i) {
-        std::set<int> epsilon_expanded_states{i};
-        std::set<int> expansions = epsilon_expansions.at(i);
-        // Populate epsilon expanded states set
-        for (const auto cell: expansions) {
-            epsilon_expanded_states.insert(cell);
-        }
-
-        for (const std::string &symbol: alphabet) {
-            for (auto state: epsilon_expanded_states) {
-                for (const NFA::Transition &t: transitions) {
-                    if (state == t.from && t.symbol == symbol) {
-                        for (TransitionPair &p: transitions_table.at(i)) {
-                            if (p.symbol == symbol) {
-                                p.to.insert(t.to);
-                            }
-                        }
-                    }
-                }
+    // Transitions in the form CompiledNFA is built from. Symbols longer than
+    // one character can never match a single input character, and states
+    // outside [0, states) do not exist, so such transitions are dropped, the
+    // same way compile() drops accept states out of range.
+    [[nodiscard]] std::vector<CompiledNFA::Arc> arcs() const {
+        std::vector<CompiledNFA::Arc> arcs{};
+        for (const Transition &t: transitions) {
+            if (t.from < 0 || t.from >= states || t.to < 0 || t.to >= states) continue;
+            if (t.symbol == EPSILON) {
+                arcs.push_back({t.from, EPSILON_ID, t.to});
+            } else if (t.symbol.size() == 1) {
+                arcs.push_back({t.from, static_cast<unsigned char>(t.symbol[0]), t.to});
             }
         }
+        return arcs;
     }
 
-    return std::pair<std::map<int, std::vector<TransitionPair>>,
-            std::map<int, std::set<int>>>{transitions_table, epsilon_expansions};
-}
-
-std::pair<std::map<int, std::set<int>>, std::map<int, std::map<std::string, std::set<int>>>> populate_transitions_table(
-    int number_of_states,
-    const std::set<std::string>& alphabet,
-    const std::vector<NFA::Transition>& transitions) {
-
-    std::map<int, std::map<std::string, std::set<int>>> transitions_table{};
-    std::map<int, std::set<int>> epsilon_expansions{};
-
-    for (int i = 0; i < number_of_states; ++i) {
-        epsilon_expansions[i] = {};
-        transitions_table[i] = {};
-        for (const std::string& letter : alphabet) {
-            transitions_table.at(i)[letter] = {};
+    // Build the dense form used for simulation.
+    [[nodiscard]] CompiledNFA compile() const {
+        std::vector<bool> accept(states, false);
+        for (const auto &[state, is_accept]: acceptStates) {
+            if (state >= 0 && state < states) accept[state] = is_accept;
         }
-    }
 
-    for (const auto& t : transitions) {
-        if (t.symbol == EPSILON) {
-            epsilon_expansions.at(t.from).insert(t.to);
-        } else {
-            transitions_table.at(t.from).at(t.symbol).insert(t.to);
-        }
+        return {states, arcs(), accept};
     }
 };
 
-NFA read_nfa_definition_input() {
+NFA read_nfa_definition_input(LineReader &input) {
     std::string n_in;
-    getline(std::cin, n_in);
+    input.next_line(n_in);
     int n{stoi(n_in)};
 
     std::string t_in;
-    getline(std::cin, t_in);
+    input.next_line(t_in);
     int t{stoi(t_in)};
 
     std::vector<NFA::Transition> transitions{};
     for (int i = 0; i < t; ++i) {
         std::string transition_string;
-        std::getline(std::cin, transition_string);
+        input.next_line(transition_string);
         transitions.push_back(NFA::split_transition_input(transition_string));
     }
 
-    std::set<std::string> alphabet{};
-    for (const auto &transition: transitions) {
-        alphabet.insert(transition.symbol);
-    }
-    alphabet.erase(EPSILON);
-
-    auto transitions_data =
-            construct_transitions_table_for_alphabet(n, alphabet, transitions);
-
     std::string f_in;
-    getline(std::cin, f_in);
+    input.next_line(f_in);
     int f{stoi(f_in)};
 
     std::map<int, bool> accept_states{};
@@ -231,112 +110,193 @@ NFA read_nfa_definition_input() {
 
     for (int i = 0; i < f; ++i) {
         std::string accept_state;
-        getline(std::cin, accept_state);
+        input.next_line(accept_state);
         accept_states[stoi(accept_state)] = true;
     }
 
-    return {alphabet, transitions_data.first, transitions_data.second,
-            accept_states};
+    return {n, transitions, accept_states};
 }
 
-std::vector<std::string> read_test_strings() {
+// Stream the test strings through the batch runner. Lines are handed out as
+// views straight from the input in batches of STREAM_BATCH_LINES, so memory
+// use does not depend on how many test strings there are and verdicts for
+// the first batch are written before the rest of the input is read.
+template<typename Matcher>
+void simulate_test_strings(LineReader &input, BatchRunner<Matcher> &runner) {
     std::string s_in;
-    getline(std::cin, s_in);
-    int s{stoi(s_in)};
-
-    std::vector<std::string> test_strings{};
-
-    for (int i = 0; i < s; ++i) {
-        std::string test_string;
-        getline(std::cin, test_string);
-        test_strings.push_back(test_string);
+    input.next_line(s_in);
+    long remaining{stol(s_in)};
+
+    std::vector<std::string_view> batch{};
+    while (remaining > 0 &&
+           input.next_batch(batch, std::min<long>(remaining, STREAM_BATCH_LINES)) > 0) {
+        remaining -= static_cast<long>(batch.size());
+        runner.run(batch, std::cout);
     }
-
-    return test_strings;
+    std::cout.flush();
 }
 
-std::string asString(char x) {
-    std::string s{x};
-    return s;
-}
+// Matcher for BatchRunner over a binary DFA written by nfa_compliment_clion.
+// The mapped tables are read-only, so all workers share one MappedDFA.
+struct MappedDFAMatcher {
+    const MappedDFA *dfa;
+
+    [[nodiscard]] bool accepts(std::string_view input) const { return dfa->accepts(input); }
+};
 
-void produceOutput(const std::set<int> &current_states, const NFA &n) {
-    for (const int state: current_states) {
-        if (n.is_accept_state(state)) {
-            std::cout << "accept" << std::endl;
-            return;
+// Search mode: every remaining input line is text to search. Prints one
+// "line end" pair (or "line start end" with starts) per match, where line
+// counts from 1 and offsets are byte offsets into the line.
+// The start reported is the leftmost one a match ending there can have.
+void search_lines(LineReader &input, const CompiledNFA &compiled, bool report_starts) {
+    const BitParallelNFA forward{compiled};
+    AutomatonSearch search{forward, report_starts ? &compiled : nullptr};
+
+    std::string output{};
+    std::vector<std::string_view> batch{};
+    size_t line_number{0};
+    while (input.next_batch(batch, STREAM_BATCH_LINES) > 0) {
+        for (const std::string_view line: batch) {
+            ++line_number;
+            search.scan(line, [&](size_t start, size_t end) {
+                output += std::to_string(line_number);
+                if (report_starts) {
+                    output += ' ';
+                    output += std::to_string(start);
+                }
+                output += ' ';
+                output += std::to_string(end);
+                output += '\n';
+            });
         }
+        std::cout.write(output.data(), static_cast<std::streamsize>(output.size()));
+        output.clear();
     }
-    std::cout << "reject" << std::endl;
+    std::cout.flush();
 }
 
-bool check_if_test_string_has_char_not_in_alphabet(const std::string& test_string, const NFA& n) {
-    bool contains_char_not_in_alphabet{false};
-    for (const auto s: test_string) {
-        if (asString(s).empty()) contains_char_not_in_alphabet = false;
-
-        bool symbol_in_alphabet{false};
-        for (const auto &symbol : n.alphabet) {
-            if (symbol == asString(s)) {
-                symbol_in_alphabet = true;
-                break;
-            }
-        }
-        if (!symbol_in_alphabet) {
-            contains_char_not_in_alphabet = true;
-            break;
+// Product mode: a second NFA definition follows the first automaton. With check_empty
+// prints "empty", or "not empty" and a shortest string in the combined
+// language ("eps" for the empty string); otherwise the test strings are run
+// against the combination.
+void run_product(LineReader &input, const CompiledNFA &compiled_left, ProductOperation operation, bool check_empty) {
+    const BitParallelNFA left{compiled_left};
+    const CompiledNFA compiled_right{read_nfa_definition_input(input).compile()};
+    const BitParallelNFA right{compiled_right};
+
+    if (check_empty) {
+        const EmptinessResult result{ProductAutomaton{left, right, operation}.check_empty()};
+        if (result.empty) {
+            std::cout << "empty" << std::endl;
+        } else {
+            std::cout << "not empty" << std::endl;
+            std::cout << (result.witness.empty() ? std::string{EPSILON} : result.witness) << std::endl;
         }
+        return;
     }
-    return contains_char_not_in_alphabet;
-}
 
-int main() {
-    NFA n{read_nfa_definition_input()};
-    std::vector<std::string> testStrings{read_test_strings()};
+    BatchRunner<ProductAutomaton> runner{[&] { return ProductAutomaton{left, right, operation}; }};
+    simulate_test_strings(input, runner);
+}
 
-    std::set<int> start_states{0};
-    for (const auto &s: n.epsilon_expansions.at(0)) {
-        start_states.insert(s);
+int run(int argc, char **argv) {
+    std::ios::sync_with_stdio(false);
+
+    bool search_mode{false};
+    bool report_starts{false};
+    bool product_mode{false};
+    bool check_empty{false};
+    ProductOperation operation{ProductOperation::INTERSECTION};
+    std::string dfa_path{};
+    std::string pattern{};
+    bool has_pattern{false};
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg{argv[i]};
+        if (arg == "--dfa" && i + 1 < argc) {
+            dfa_path = argv[++i];
+        } else if (arg == "--regex" && i + 1 < argc) {
+            pattern = argv[++i];
+            has_pattern = true;
+        } else if (arg == "--search") {
+            search_mode = true;
+        } else if (arg == "--starts") {
+            search_mode = true;
+            report_starts = true;
+        } else if (arg == "--intersection" || arg == "--union" || arg == "--difference") {
+            product_mode = true;
+            operation = arg == "--intersection" ? ProductOperation::INTERSECTION
+                        : arg == "--union" ? ProductOperation::UNION
+                        : ProductOperation::DIFFERENCE;
+        } else if (arg == "--empty") {
+            check_empty = true;
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--dfa dfa_file | [--regex pattern]"
+                      << " [--search [--starts] | --intersection | --union | --difference [--empty]]]"
+                      << " < input" << std::endl;
+            return 1;
+        }
     }
-    for (const std::string &test_string: testStrings) {
-        std::set<int> current_states{start_states};
-        std::set<int> next_states{};
 
-        if (test_string.empty()) {
-            produceOutput(current_states, n);
-            continue;
-        }
+    LineReader input{STDIN_FILENO};
 
-        bool contains_char_not_in_alphabet{check_if_test_string_has_char_not_in_alphabet(test_string, n)};
-        if (contains_char_not_in_alphabet) {
-            std::cout << "reject" << '\n';
-            continue;
+    if (!dfa_path.empty()) {
+        // The input holds only the test strings, the automaton comes from the file
+        const MappedDFA dfa{dfa_path};
+        if (!dfa.error().empty()) {
+            std::cerr << dfa.error() << std::endl;
+            return 1;
         }
+        BatchRunner<MappedDFAMatcher> runner{[&dfa] { return MappedDFAMatcher{&dfa}; }};
+        simulate_test_strings(input, runner);
+        return 0;
+    }
 
-        for (int j = 0; j < test_string.length(); ++j) {
-            for (const int state : current_states) {
-                for (const TransitionPair &transition_states: n.transition_table.at(state)) {
-                    if (transition_states.symbol == asString(test_string[j])) {
-                        for (const int s: transition_states.to) {
-                            next_states.insert(s);
-                            std::set<int> eps_transitions = n.epsilon_expansions.at(s);
-                            for (const int eps_transition: eps_transitions) {
-                                next_states.insert(eps_transition);
-                            }
-                        }
-                    }
-                }
-            }
+    if (check_empty && !product_mode) {
+        std::cerr << "--empty needs one of --intersection, --union or --difference" << std::endl;
+        return 1;
+    }
 
-            current_states.clear();
-            if (!next_states.empty()) {
-                current_states = next_states;
-                next_states.clear();
-            }
+    // The automaton comes either from a pattern on the command line, which
+    // must match whole lines, or from the NFA definition at the start of the input
+    RegexNFA regex{};
+    std::optional<NFA> n{};
+    if (has_pattern) {
+        regex = compile_regex(pattern);
+        if (!regex.error.empty()) {
+            std::cerr << "invalid pattern: " << regex.error << std::endl;
+            return 1;
         }
+    } else {
+        n.emplace(read_nfa_definition_input(input));
+    }
+    const CompiledNFA compiled{has_pattern ? regex.compile() : n->compile()};
 
-        produceOutput(current_states, n);
+    if (product_mode) {
+        run_product(input, compiled, operation, check_empty);
+        return 0;
     }
 
+    if (search_mode) {
+        search_lines(input, compiled, report_starts);
+        return 0;
+    }
+
+    const BitParallelNFA bit_parallel{compiled};
+    // Every worker gets its own DFA cache over the shared, read-only NFA
+    BatchRunner<LazyDFA> runner{[&bit_parallel] { return LazyDFA{bit_parallel}; }};
+    simulate_test_strings(input, runner);
+
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char **argv) {
+    // The automata are sized by the input, so one too big to build is a
+    // bad input like any other rather than a crash
+    try {
+        return run(argc, argv);
+    } catch (const std::bad_alloc &) {
+        std::cerr << "out of memory building the automaton" << std::endl;
+        return 1;
+    }
+}
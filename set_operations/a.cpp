@@ -1,8 +1,8 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <array>
 #include <algorithm>
+#include <utility>
 
 std::vector<std::string> readInSetItems()
 {
@@ -21,81 +21,285 @@ std::vector<std::string> readInSetItems()
   return set;
 }
 
-void construct_cartesian_product(std::vector<std::string> &set1, std::vector<std::string> &set2)
+// Pairs of the cartesian product of two sets, in order, as a range. The
+// pairs refer to the items of the sets instead of copying them, so going
+// through the product takes no memory beyond the sets themselves
+class CartesianProduct
 {
-  std::vector<std::array<std::string, 2>> cartesian_product_set{};
+public:
+  class iterator
+  {
+  public:
+    iterator(const CartesianProduct *product, size_t i, size_t j) : product(product), i(i), j(j) {}
+
+    std::pair<const std::string &, const std::string &> operator*() const
+    {
+      return {product->set1[i], product->set2[j]};
+    }
+
+    iterator &operator++()
+    {
+      if (++j == product->set2.size())
+      {
+        j = 0;
+        ++i;
+      }
+      return *this;
+    }
+
+    bool operator!=(const iterator &other) const { return i != other.i || j != other.j; }
+
+  private:
+    const CartesianProduct *product;
+    size_t i;
+    size_t j;
+  };
+
+  CartesianProduct(const std::vector<std::string> &set1, const std::vector<std::string> &set2) : set1(set1), set2(set2) {}
 
-  for (int i = 0; i < set1.size(); ++i)
+  iterator begin() const { return set2.empty() ? end() : iterator(this, 0, 0); }
+  iterator end() const { return iterator(this, set1.size(), 0); }
+
+private:
+  const std::vector<std::string> &set1;
+  const std::vector<std::string> &set2;
+};
+
+// Collects output in a large buffer and hands it to the stream a buffer at
+// a time, so writing millions of short lines is not one stream call each
+class BufferedWriter
+{
+public:
+  explicit BufferedWriter(std::ostream &out, size_t capacity = 1 << 20) : out(out), capacity(capacity)
   {
-    for (int j = 0; j < set2.size(); ++j)
+    buffer.reserve(capacity);
+  }
+
+  ~BufferedWriter() { flush(); }
+
+  void write(const std::string &text)
+  {
+    if (buffer.size() + text.size() > capacity)
     {
-      const std::array<std::string, 2> product{{set1[i], set2[j]}};
-      cartesian_product_set.push_back(product);
+      flush();
     }
+    buffer += text;
+  }
+
+  void put(char c)
+  {
+    if (buffer.size() == capacity)
+    {
+      flush();
+    }
+    buffer += c;
+  }
+
+  void flush()
+  {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+  }
+
+private:
+  std::ostream &out;
+  size_t capacity;
+  std::string buffer;
+};
+
+void construct_cartesian_product(const std::vector<std::string> &set1, const std::vector<std::string> &set2)
+{
+  BufferedWriter writer{std::cout};
+  for (const auto &pair : CartesianProduct(set1, set2))
+  {
+    writer.write(pair.first);
+    writer.put(' ');
+    writer.write(pair.second);
+    writer.put('\n');
+  }
+  writer.put('\n');
+}
+
+using SetIterator = std::vector<std::string>::const_iterator;
+
+// Sets differing in size by more than this factor are intersected (or
+// subtracted) by galloping through the larger one instead of merging
+constexpr size_t gallop_ratio = 16;
+
+// The sets are sorted but may repeat items; step past every copy of the
+// item at it
+SetIterator skip_equal(SetIterator it, SetIterator end)
+{
+  const std::string &item = *it;
+  do
+  {
+    ++it;
+  } while (it != end && *it == item);
+  return it;
+}
+
+// First position in [it, end) whose item is not less than value. Steps that
+// double in length find a range holding it, then a binary search finishes,
+// so the cost is logarithmic in how far it moves rather than in the set size
+SetIterator gallop(SetIterator it, SetIterator end, const std::string &value)
+{
+  if (it == end || !(*it < value))
+  {
+    return it;
+  }
+  size_t step = 1;
+  while (static_cast<size_t>(end - it) > step && *(it + step) < value)
+  {
+    it += step;
+    step *= 2;
   }
+  return std::lower_bound(it + 1, static_cast<size_t>(end - it) > step ? it + step + 1 : end, value);
+}
 
-  for (int i = 0; i < cartesian_product_set.size(); ++i)
+void print_set(const std::vector<std::string> &set)
+{
+  for (const std::string &item : set)
   {
-    std::cout << cartesian_product_set[i][0] << " " << cartesian_product_set[i][1] << '\n';
+    std::cout << item << '\n';
   }
+
   std::cout << '\n';
 }
 
-void construct_intersection(std::vector<std::string> &set1, std::vector<std::string> &set2)
+void construct_intersection(const std::vector<std::string> &set1, const std::vector<std::string> &set2)
 {
   std::vector<std::string> intersection_set{};
+  const std::vector<std::string> &small = set1.size() <= set2.size() ? set1 : set2;
+  const std::vector<std::string> &large = set1.size() <= set2.size() ? set2 : set1;
 
-  for (int i = 0; i < set1.size(); i++)
+  if (small.size() * gallop_ratio < large.size())
   {
-    for (int j = 0; j < set2.size(); j++)
+    SetIterator found = large.begin();
+    for (SetIterator it = small.begin(); it != small.end(); it = skip_equal(it, small.end()))
     {
-      if (set1[i] == set2[j] && std::find(intersection_set.begin(), intersection_set.end(), set1[i]) == intersection_set.end())
+      found = gallop(found, large.end(), *it);
+      if (found != large.end() && *found == *it)
       {
-        intersection_set.push_back(set1[i]);
+        intersection_set.push_back(*it);
       }
     }
   }
-
-  std::sort(intersection_set.begin(), intersection_set.end());
-
-  for (int i = 0; i < intersection_set.size(); ++i)
+  else
   {
-    std::cout << intersection_set[i] << '\n';
+    SetIterator a = set1.begin();
+    SetIterator b = set2.begin();
+    while (a != set1.end() && b != set2.end())
+    {
+      if (*a < *b)
+      {
+        ++a;
+      }
+      else if (*b < *a)
+      {
+        ++b;
+      }
+      else
+      {
+        intersection_set.push_back(*a);
+        a = skip_equal(a, set1.end());
+        b = skip_equal(b, set2.end());
+      }
+    }
   }
 
-  std::cout << '\n';
+  print_set(intersection_set);
 }
 
-void construct_union(std::vector<std::string> &set1, std::vector<std::string> &set2)
+void construct_union(const std::vector<std::string> &set1, const std::vector<std::string> &set2)
 {
   std::vector<std::string> union_set{};
-  for (int i = 0; i < set1.size(); ++i)
+  SetIterator a = set1.begin();
+  SetIterator b = set2.begin();
+  while (a != set1.end() || b != set2.end())
   {
-    if (std::find(union_set.begin(), union_set.end(), set1[i]) == union_set.end())
+    if (b == set2.end() || (a != set1.end() && *a < *b))
+    {
+      union_set.push_back(*a);
+      a = skip_equal(a, set1.end());
+    }
+    else if (a == set1.end() || *b < *a)
+    {
+      union_set.push_back(*b);
+      b = skip_equal(b, set2.end());
+    }
+    else
     {
-      union_set.push_back(set1[i]);
+      union_set.push_back(*a);
+      a = skip_equal(a, set1.end());
+      b = skip_equal(b, set2.end());
     }
   }
-  for (int j = 0; j < set2.size(); ++j)
+
+  print_set(union_set);
+}
+
+// Items of set1 that are not in set2
+void construct_difference(const std::vector<std::string> &set1, const std::vector<std::string> &set2)
+{
+  std::vector<std::string> difference_set{};
+  const bool skewed = set1.size() * gallop_ratio < set2.size();
+  SetIterator b = set2.begin();
+  for (SetIterator a = set1.begin(); a != set1.end(); a = skip_equal(a, set1.end()))
   {
-    if (std::find(union_set.begin(), union_set.end(), set2[j]) == union_set.end())
+    if (skewed)
     {
-      union_set.push_back(set2[j]);
+      b = gallop(b, set2.end(), *a);
+    }
+    else
+    {
+      while (b != set2.end() && *b < *a)
+      {
+        ++b;
+      }
+    }
+    if (b == set2.end() || *a < *b)
+    {
+      difference_set.push_back(*a);
     }
   }
 
-  std::sort(union_set.begin(), union_set.end());
+  print_set(difference_set);
+}
 
-  for (int i = 0; i < union_set.size(); ++i)
+// Items in exactly one of the sets
+void construct_symmetric_difference(const std::vector<std::string> &set1, const std::vector<std::string> &set2)
+{
+  std::vector<std::string> symmetric_difference_set{};
+  SetIterator a = set1.begin();
+  SetIterator b = set2.begin();
+  while (a != set1.end() || b != set2.end())
   {
-    std::cout << union_set[i] << '\n';
+    if (b == set2.end() || (a != set1.end() && *a < *b))
+    {
+      symmetric_difference_set.push_back(*a);
+      a = skip_equal(a, set1.end());
+    }
+    else if (a == set1.end() || *b < *a)
+    {
+      symmetric_difference_set.push_back(*b);
+      b = skip_equal(b, set2.end());
+    }
+    else
+    {
+      a = skip_equal(a, set1.end());
+      b = skip_equal(b, set2.end());
+    }
   }
 
-  std::cout << '\n';
+  print_set(symmetric_difference_set);
 }
 
-int main()
+// With --difference and --symmetric-difference those sets are printed too,
+// after the cartesian product
+int main(int argc, char **argv)
 {
+  std::ios::sync_with_stdio(false);
+
   std::vector<std::string> set1 = readInSetItems();
   std::vector<std::string> set2 = readInSetItems();
 
@@ -106,5 +310,18 @@ int main()
   construct_intersection(set1, set2);
   construct_cartesian_product(set1, set2);
 
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--difference")
+    {
+      construct_difference(set1, set2);
+    }
+    else if (arg == "--symmetric-difference")
+    {
+      construct_symmetric_difference(set1, set2);
+    }
+  }
+
   return 0;
 }
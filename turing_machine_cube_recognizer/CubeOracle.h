@@ -0,0 +1,31 @@
+#ifndef TM_CUBE_ORACLE_H
+#define TM_CUBE_ORACLE_H
+
+#include "MachineResult.h"
+#include <cstdint>
+#include <string>
+
+// largest r with r * r * r <= n
+inline uint64_t integerCubeRoot(uint64_t n) {
+    uint64_t low = 0;
+    uint64_t high = 2642245; // the cube root of UINT64_MAX, rounded down
+    while (low < high) {
+        uint64_t middle = (low + high + 1) / 2;
+        if (middle * middle * middle <= n) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+// The answer the cube recognizers have to give, straight from arithmetic:
+// accept when the length of the input is a perfect cube. Like the built in
+// recognizer it only looks at the length, whatever the symbols are.
+inline MachineVerdict cubeOracle(const std::string &input) {
+    uint64_t root = integerCubeRoot(input.size());
+    return root * root * root == input.size() ? MachineVerdict::ACCEPT : MachineVerdict::REJECT;
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef TM_CUBE_RECOGNIZER_H
+#define TM_CUBE_RECOGNIZER_H
+
+#include "MachineResult.h"
+#include "RunLengthTape.h"
+#include "TuringMachineTape.h"
+#include <string>
+
+// The hand written recognizer for inputs whose length is a perfect cube.
+// The tapes are kept between runs and reset in place, so one recognizer
+// runs any number of inputs. The tape types can be swapped for ProfiledTape
+// wrappers to see what the run does to them.
+template<typename InputTape = TuringMachineTape, typename CountTape = RunLengthTape>
+class CubeRecognizer {
+public:
+    explicit CubeRecognizer(InputTape inputTape = InputTape(), CountTape countTape = CountTape(),
+                            CountTape incrementerTape = CountTape())
+            : inputTape(inputTape), countTape(countTape), incrementerTape(incrementerTape) {}
+
+    MachineVerdict run(const std::string &input) {
+        inputTape.reset(input);
+        TuringMachineUtility::insertBegin(&inputTape);
+
+        // The count and incrementer tapes grow by shiftAndInsert and are long
+        // runs of 'x' and 'y', which is what RunLengthTape is good at
+        countTape.reset();
+        TuringMachineUtility::insertBegin(&countTape);
+        countTape.write('x');
+
+        incrementerTape.reset();
+        TuringMachineUtility::insertBegin(&incrementerTape);
+
+        while(true) {
+            while(incrementerTape.read() != BLANK_SYMBOL) {
+                TuringMachineUtility::shiftAndInsert(&countTape, 'x');
+                TuringMachineUtility::shiftAndInsert(&countTape, 'x');
+                TuringMachineUtility::shiftAndInsert(&countTape, 'x');
+                TuringMachineUtility::shiftAndInsert(&countTape, 'x');
+                TuringMachineUtility::shiftAndInsert(&countTape, 'x');
+                TuringMachineUtility::shiftAndInsert(&countTape, 'x');
+
+                incrementerTape.right();
+            }
+            TuringMachineUtility::shiftAndInsert(&incrementerTape, 'y');
+            TuringMachineUtility::rewind(&countTape);
+            TuringMachineUtility::rewind(&incrementerTape);
+
+            while(true) {
+                inputTape.right();
+                countTape.right();
+                if (inputTape.read() == BLANK_SYMBOL && countTape.read() != BLANK_SYMBOL) {
+                    return MachineVerdict::REJECT;
+                } else if (countTape.read() == BLANK_SYMBOL && inputTape.read() != BLANK_SYMBOL) {
+                    // through what needs done here, need to increment the count_tape
+                    break;
+                } else if (countTape.read() == BLANK_SYMBOL && inputTape.read() == BLANK_SYMBOL) {
+                    // Both ended on BLANK_SYMBOL at the same time, so it is a cube,
+                    // unless a tape rejected on the way here
+                    return rejected() ? MachineVerdict::REJECT : MachineVerdict::ACCEPT;
+                }
+            }
+            TuringMachineUtility::rewind(&countTape);
+
+            // the tapes reject instead of exiting, so stop as soon as one has
+            if (rejected()) return MachineVerdict::REJECT;
+        }
+    }
+
+    const InputTape &input() const { return inputTape; }
+    const CountTape &count() const { return countTape; }
+    const CountTape &incrementer() const { return incrementerTape; }
+
+private:
+    bool rejected() const {
+        return inputTape.rejected() || countTape.rejected() || incrementerTape.rejected();
+    }
+
+    InputTape inputTape;
+    CountTape countTape;
+    CountTape incrementerTape;
+};
+
+#endif
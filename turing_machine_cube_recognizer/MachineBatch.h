@@ -0,0 +1,41 @@
+#ifndef TM_MACHINE_BATCH_H
+#define TM_MACHINE_BATCH_H
+
+#include "MachineResult.h"
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs every input and returns the results in input order. makeRunner()
+// is called once per thread and gives a callable taking an input string and
+// returning its MachineResult; it is reused for all the inputs that thread
+// runs, so it can keep its tapes. Run times differ wildly between inputs,
+// so the inputs are handed out one at a time from a shared counter rather
+// than split up front.
+template<typename MakeRunner>
+std::vector<MachineResult> runBatch(const std::vector<std::string> &inputs, MakeRunner makeRunner,
+                                    unsigned threadCount = 1) {
+    std::vector<MachineResult> results(inputs.size());
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        auto runner = makeRunner();
+        for (size_t i = next++; i < inputs.size(); i = next++) {
+            results[i] = runner(inputs[i]);
+        }
+    };
+
+    threadCount = static_cast<unsigned>(std::min<size_t>(std::max(1u, threadCount), std::max<size_t>(1, inputs.size())));
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < threadCount; ++t) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return results;
+}
+
+#endif
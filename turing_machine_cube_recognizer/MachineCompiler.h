@@ -0,0 +1,141 @@
+#ifndef TM_MACHINE_COMPILER_H
+#define TM_MACHINE_COMPILER_H
+
+#include "TableMachine.h"
+#include <algorithm>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Writes a header with one function,
+//
+//   inline MachineResult functionName(const std::string &input, uint64_t stepLimit)
+//
+// that runs the machine exactly like TableMachine::run (same verdicts, same
+// step counts) but with the transition table compiled away. Every state is a
+// label and a switch on the symbols under the heads, and every case is the
+// step itself with the writes, moves and next state as constants: writes
+// that leave the symbol as it is are dropped, and the next state is a direct
+// goto. Sweeps still go through MachineTapes::sweepLength.
+//
+// source is only used in the comment at the top of the header.
+inline void compileMachine(const TuringMachineTable &machine, const std::string &functionName,
+                           const std::string &source, std::ostream &out) {
+    const int tapeCount = machine.tapeCount();
+    const int accept = machine.acceptState();
+    const int reject = machine.rejectState();
+
+    // the halting states are never dispatched on, and only the states some
+    // goto reaches get a label so the generated code has no unused ones
+    std::vector<bool> reached(machine.stateCount(), false);
+    reached[machine.startState()] = true;
+    for (int state = 0; state < machine.stateCount(); ++state) {
+        if (state == accept || state == reject) continue;
+        for (size_t symbols = 0; symbols < machine.symbolCombinations(); ++symbols) {
+            const TuringMachineTable::Transition &t = machine.transition(state, symbols);
+            if (t.next != TABLE_NO_STATE) reached[t.next] = true;
+        }
+    }
+
+    out << "// generated by tm_codegen from " << source << ", do not edit\n";
+    out << "#include \"TableMachine.h\"\n";
+    out << "#include <cstdint>\n";
+    out << "#include <string>\n\n";
+    out << "inline MachineResult " << functionName << "(const std::string &input, uint64_t stepLimit) {\n";
+
+    out << "    static const int codes[256] = {";
+    for (int c = 0; c < 256; ++c) {
+        out << (c % 32 == 0 ? "\n        " : " ") << machine.inputCode(static_cast<char>(c)) << ",";
+    }
+    out << "\n    };\n";
+    out << "    MachineTapes tapes(" << tapeCount << ");\n";
+    out << "    if (!tapes.load(input, [](char c) { return codes[static_cast<unsigned char>(c)]; })) {\n";
+    out << "        return {MachineVerdict::REJECT, 0};\n";
+    out << "    }\n";
+    out << "    uint64_t steps = 0;\n";
+    out << "    goto state" << machine.startState() << ";\n";
+
+    for (int state = 0; state < machine.stateCount(); ++state) {
+        if (!reached[state]) continue;
+        out << "\nstate" << state << ": // " << machine.stateName(state) << "\n";
+        if (state == accept) {
+            out << "    return {MachineVerdict::ACCEPT, steps};\n";
+            continue;
+        }
+        if (state == reject) {
+            out << "    return {MachineVerdict::REJECT, steps};\n";
+            continue;
+        }
+
+        out << "    if (steps >= stepLimit) return {MachineVerdict::STEP_LIMIT, steps};\n";
+        out << "    switch (";
+        for (int i = 0; i < tapeCount; ++i) {
+            out << (i ? " + " : "") << "tapes.read(" << i << ")";
+            if (machine.tapeWeight(i) != 1) out << " * " << machine.tapeWeight(i);
+        }
+        out << ") {\n";
+
+        // symbol combinations that take the same step share one case body
+        std::vector<std::string> bodies;
+        std::vector<std::string> labels;
+        for (size_t symbols = 0; symbols < machine.symbolCombinations(); ++symbols) {
+            const TuringMachineTable::Transition &t = machine.transition(state, symbols);
+            if (t.next == TABLE_NO_STATE) continue;
+
+            std::ostringstream label;
+            label << "    case " << symbols << ": //";
+            for (int i = 0; i < tapeCount; ++i) {
+                label << " " << machine.symbolName(static_cast<int>(symbols / machine.tapeWeight(i) % machine.symbolCount()));
+            }
+            label << "\n";
+
+            std::ostringstream body;
+            if (t.sweep) {
+                body << "        {\n";
+                body << "            static const unsigned char write[] = {";
+                for (int i = 0; i < tapeCount; ++i) body << (i ? ", " : "") << static_cast<int>(t.write[i]);
+                body << "};\n";
+                body << "            static const signed char move[] = {";
+                for (int i = 0; i < tapeCount; ++i) body << (i ? ", " : "") << static_cast<int>(t.move[i]);
+                body << "};\n";
+                body << "            uint64_t repeat = tapes.sweepLength(move, stepLimit - steps);\n";
+                body << "            if (repeat == 0) return {MachineVerdict::STEP_LIMIT, stepLimit};\n";
+                body << "            if (!tapes.step(write, move, repeat)) return {MachineVerdict::REJECT, steps + 1};\n";
+                body << "            steps += repeat;\n";
+                body << "        }\n";
+            } else {
+                for (int i = 0; i < tapeCount; ++i) {
+                    const size_t read = symbols / machine.tapeWeight(i) % machine.symbolCount();
+                    if (t.write[i] != read) {
+                        body << "        tapes.write(" << i << ", " << static_cast<int>(t.write[i]) << ");\n";
+                    }
+                    if (t.move[i] > 0) {
+                        body << "        tapes.right(" << i << ");\n";
+                    } else if (t.move[i] < 0) {
+                        body << "        if (!tapes.left(" << i << ")) return {MachineVerdict::REJECT, steps + 1};\n";
+                    }
+                }
+                body << "        ++steps;\n";
+            }
+            body << "        goto state" << t.next << ";\n";
+
+            size_t b = std::find(bodies.begin(), bodies.end(), body.str()) - bodies.begin();
+            if (b == bodies.size()) {
+                bodies.push_back(body.str());
+                labels.emplace_back();
+            }
+            labels[b] += label.str();
+        }
+        for (size_t b = 0; b < bodies.size(); ++b) {
+            out << labels[b] << bodies[b];
+        }
+
+        out << "    default:\n";
+        out << "        return {MachineVerdict::REJECT, steps};\n";
+        out << "    }\n";
+    }
+    out << "}\n";
+}
+
+#endif
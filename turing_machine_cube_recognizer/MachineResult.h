@@ -0,0 +1,24 @@
+#ifndef TM_MACHINE_RESULT_H
+#define TM_MACHINE_RESULT_H
+
+#include <cstdint>
+
+enum class MachineVerdict { ACCEPT, REJECT, STEP_LIMIT };
+
+// outcome of running a machine on one input
+struct MachineResult {
+    MachineVerdict verdict;
+    uint64_t steps;
+};
+
+// "accept", "reject" or "step limit"
+inline const char *verdictName(MachineVerdict verdict) {
+    switch (verdict) {
+        case MachineVerdict::ACCEPT: return "accept";
+        case MachineVerdict::REJECT: return "reject";
+        case MachineVerdict::STEP_LIMIT: return "step limit";
+    }
+    return "";
+}
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef TM_RUN_LENGTH_TAPE_H
+#define TM_RUN_LENGTH_TAPE_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TuringMachineTape.h"
+
+// Tape with the TuringMachineTape interface that stores runs of equal
+// symbols in a gap buffer kept at the head. Runs left of the head are in
+// `before`, the one touching the head last. Runs from the head on are in
+// `after` in reverse order, so the head is always on the first cell of
+// after.back(). Moving the head and writing only touch the ends of the two
+// stacks. An insert also takes one cell out of the first blank run after the
+// head, which costs a scan and an erase over the runs up to that blank, so
+// shiftAndInsert is O(runs between the head and the next blank) instead of a
+// shift of every cell, and a run of 'x' takes one entry however long it
+// grows.
+class RunLengthTape {
+public:
+    // construct a tape with input read from the first line of the given
+    // stream (or no input at all)
+    RunLengthTape(std::istream *input=NULL) {
+        std::string line;
+        if (input) getline(*input, line);
+        reset(line);
+    }
+
+    // start over with the given input, keeping the run buffers
+    void reset(const std::string &input = "") {
+        before.clear();
+        after.clear();
+        blankRunsAfter = 0;
+        afterCells = 0;
+        position = 0;
+        failed = false;
+        for (auto c = input.rbegin(); c != input.rend(); ++c) {
+            pushAfter(*c);
+        }
+    }
+
+    // return the symbol at the head
+    int read() const { return after.empty() ? BLANK_SYMBOL : after.back().symbol; }
+
+    // write given symbol at the head
+    void write(int symbol) {
+        if (symbol == BLANK_SYMBOL) return reject();
+        popAfter();
+        pushAfter(symbol);
+    }
+
+    // move right / left
+    void right() { pushBefore(popAfter()); ++position; }
+    void left() { if (position <= 0) return reject(); pushAfter(popBefore()); --position; }
+
+    // same as TuringMachineTape::insert: everything from the head up to the
+    // first blank moves right by one. The cells only move relative to the
+    // head, so all that changes is one cell joining `before` and, if there
+    // is a blank further on, that blank cell going away.
+    void insert(int symbol) {
+        if (symbol == BLANK_SYMBOL) return reject();
+        pushBefore(symbol);
+        ++position;
+        if (blankRunsAfter > 0) {
+            removeFirstBlankAfter();
+        }
+    }
+
+    // dump the contents of the tape, one entry per run ("x*5" for five x's)
+    void debug(std::ostream *out=&std::cout) const {
+        std::vector<std::string> terms;
+        for (const Run &run : before) {
+            terms.push_back(describe(run));
+        }
+        const size_t head = terms.size();
+        for (auto run = after.rbegin(); run != after.rend(); ++run) {
+            terms.push_back(describe(*run));
+        }
+        if (after.empty()) {
+            terms.push_back(TuringMachineTape::describe(BLANK_SYMBOL));
+        }
+
+        for (const std::string &term : terms) {
+            *out << "| " << term << " ";
+        }
+        *out << "|" << std::endl;
+
+        for (size_t i = 0; i < terms.size(); ++i) {
+            *out << "| " << std::setw(terms[i].length()) << ((i == head) ? '^' : ' ') << " ";
+        }
+        *out << "|" << std::endl;
+
+        *out << '\n';
+    }
+
+    // cells up to the end of the last run or the head, whichever is further.
+    // Blanks the head has moved back over stay in `after` and count here, so
+    // this can be more than TuringMachineTape::length at the same point; the
+    // peak over a run, which is what ProfiledTape records, is the same.
+    size_t length() const { return position + std::max<size_t>(afterCells, 1); }
+
+    // same as TuringMachineTape::reject
+    void reject() { failed = true; }
+    bool rejected() const { return failed; }
+
+private:
+    struct Run {
+        int symbol;
+        size_t length;
+    };
+
+    std::vector<Run> before;
+    std::vector<Run> after;
+    // number of runs of BLANK_SYMBOL in `after`, so insert only has to look
+    // for one when there is one
+    size_t blankRunsAfter = 0;
+    // number of cells in `after`
+    size_t afterCells = 0;
+    size_t position = 0;
+    bool failed = false;
+
+    static std::string describe(const Run &run) {
+        std::string term = TuringMachineTape::describe(run.symbol);
+        if (run.length > 1) term += "*" + std::to_string(run.length);
+        return term;
+    }
+
+    void pushBefore(int symbol) {
+        if (!before.empty() && before.back().symbol == symbol) {
+            ++before.back().length;
+        } else {
+            before.push_back({symbol, 1});
+        }
+    }
+
+    int popBefore() {
+        int symbol = before.back().symbol;
+        if (--before.back().length == 0) before.pop_back();
+        return symbol;
+    }
+
+    // put a cell under the head, pushing the rest right
+    void pushAfter(int symbol) {
+        ++afterCells;
+        if (!after.empty() && after.back().symbol == symbol) {
+            ++after.back().length;
+        } else {
+            after.push_back({symbol, 1});
+            if (symbol == BLANK_SYMBOL) ++blankRunsAfter;
+        }
+    }
+
+    // take the cell under the head off; past the end it is a blank
+    int popAfter() {
+        if (after.empty()) return BLANK_SYMBOL;
+        --afterCells;
+        int symbol = after.back().symbol;
+        if (--after.back().length == 0) {
+            after.pop_back();
+            if (symbol == BLANK_SYMBOL) --blankRunsAfter;
+        }
+        return symbol;
+    }
+
+    // drop one cell of the blank run nearest the head, merging the runs on
+    // either side if it disappears
+    void removeFirstBlankAfter() {
+        size_t i = after.size();
+        while (after[i - 1].symbol != BLANK_SYMBOL) --i;
+        --i;
+        --afterCells;
+        if (--after[i].length > 0) return;
+
+        after.erase(after.begin() + i);
+        --blankRunsAfter;
+        if (i > 0 && i < after.size() && after[i - 1].symbol == after[i].symbol) {
+            after[i - 1].length += after[i].length;
+            after.erase(after.begin() + i);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,391 @@
+#ifndef TM_TABLE_MACHINE_H
+#define TM_TABLE_MACHINE_H
+
+#include "MachineResult.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Most tapes a table machine may have
+#define TABLE_MAX_TAPES 4
+// Largest number of (state, symbols under the heads) cells in the table
+#define TABLE_MAX_CELLS (1 << 24)
+// Symbol names in a machine file: '_' is the blank, '*' matches any symbol
+// when read and leaves the cell alone when written
+#define TABLE_BLANK '_'
+#define TABLE_ANY '*'
+#define TABLE_NO_STATE -1
+
+// A multi-tape Turing machine read from a text file:
+//
+//   # comment
+//   tapes 3
+//   input ab
+//   start init
+//   accept yes
+//   reject no
+//   init a _ _ -> scan a x _ R R S
+//
+// A transition line names the state, the symbol under each head, "->", the
+// next state, the symbol to write on each tape and the move on each tape
+// (L, R or S). Symbols are single characters, and `input` lists the ones
+// the input may contain (an input with any other character is rejected).
+// Reading with no transition rejects, and so does moving left off cell 0,
+// like TuringMachineTape.
+//
+// The transitions are expanded into one dense array indexed by state and the
+// symbols under all heads, so a step is a single lookup.
+class TuringMachineTable {
+public:
+    struct Transition {
+        int next = TABLE_NO_STATE;
+        unsigned char write[TABLE_MAX_TAPES];
+        signed char move[TABLE_MAX_TAPES];
+        // next == this state and every tape that stays keeps its symbol, so
+        // the step can repeat over a run of equal symbols
+        bool sweep = false;
+    };
+
+    explicit TuringMachineTable(std::istream &in) { load(in); }
+
+    // Empty when the machine was read without problems.
+    const std::string &error() const { return loadError; }
+
+    int tapeCount() const { return tapes; }
+    int stateCount() const { return static_cast<int>(stateNames.size()); }
+    int symbolCount() const { return static_cast<int>(symbolNames.size()); }
+    int startState() const { return start; }
+    int acceptState() const { return accept; }
+    int rejectState() const { return reject; }
+    const std::string &stateName(int state) const { return stateNames[state]; }
+    // the character for a symbol code; code 0 is the blank
+    char symbolName(int code) const { return symbolNames[code]; }
+
+    // code of an input character, or -1 if it is not listed in `input`
+    int inputCode(char c) const { return inputCodes[static_cast<unsigned char>(c)]; }
+
+    // number of different combinations of symbols under the heads
+    size_t symbolCombinations() const { return combinations; }
+
+    // transition for a state and the symbols under the heads, combined as
+    // the sum of each tape's symbol code times tapeWeight(tape)
+    const Transition &transition(int state, size_t symbols) const {
+        return table[static_cast<size_t>(state) * combinations + symbols];
+    }
+
+    // weight of tape i in the combined symbol index
+    size_t tapeWeight(int tape) const { return weights[tape]; }
+
+private:
+    int tapes = 0;
+    int start = TABLE_NO_STATE;
+    int accept = TABLE_NO_STATE;
+    int reject = TABLE_NO_STATE;
+    std::vector<std::string> stateNames;
+    std::vector<char> symbolNames;
+    int codes[256];
+    // codes restricted to the characters listed in `input`
+    int inputCodes[256];
+    size_t combinations = 0;
+    size_t weights[TABLE_MAX_TAPES];
+    std::vector<Transition> table;
+    std::string loadError;
+
+    struct Rule {
+        int state;
+        std::string reads;
+        int next;
+        std::string writes;
+        std::string moves;
+    };
+
+    int stateId(const std::string &name, std::map<std::string, int> &ids) {
+        auto found = ids.find(name);
+        if (found != ids.end()) return found->second;
+        ids.emplace(name, stateCount());
+        stateNames.push_back(name);
+        return stateCount() - 1;
+    }
+
+    void addSymbol(char c) {
+        if (c == TABLE_ANY || codes[static_cast<unsigned char>(c)] != -1) return;
+        codes[static_cast<unsigned char>(c)] = symbolCount();
+        symbolNames.push_back(c);
+    }
+
+    void fail(int line, const std::string &message) {
+        if (loadError.empty()) loadError = "line " + std::to_string(line) + ": " + message;
+    }
+
+    void load(std::istream &in) {
+        std::fill(codes, codes + 256, -1);
+        std::fill(inputCodes, inputCodes + 256, -1);
+        addSymbol(TABLE_BLANK);
+
+        std::map<std::string, int> ids;
+        std::vector<Rule> rules;
+        std::string startName, acceptName, rejectName;
+        std::string line;
+        int lineNumber = 0;
+        while (getline(in, line) && loadError.empty()) {
+            ++lineNumber;
+            std::istringstream words(line.substr(0, line.find('#')));
+            std::vector<std::string> w;
+            for (std::string word; words >> word;) w.push_back(word);
+            if (w.empty()) continue;
+
+            if (w[0] == "tapes" && w.size() == 2) {
+                tapes = atoi(w[1].c_str());
+                if (tapes < 1 || tapes > TABLE_MAX_TAPES) {
+                    fail(lineNumber, "tapes must be between 1 and " + std::to_string(TABLE_MAX_TAPES));
+                }
+            } else if (w[0] == "input" && w.size() == 2) {
+                for (char c : w[1]) {
+                    if (c == TABLE_ANY) fail(lineNumber, std::string{"input symbols cannot include "} + TABLE_ANY);
+                    addSymbol(c);
+                    inputCodes[static_cast<unsigned char>(c)] = codes[static_cast<unsigned char>(c)];
+                }
+            } else if (w[0] == "start" && w.size() == 2) {
+                startName = w[1];
+            } else if (w[0] == "accept" && w.size() == 2) {
+                acceptName = w[1];
+            } else if (w[0] == "reject" && w.size() == 2) {
+                rejectName = w[1];
+            } else if (tapes > 0 && w.size() == static_cast<size_t>(3 * tapes + 3) && w[tapes + 1] == "->") {
+                Rule rule{stateId(w[0], ids), "", stateId(w[tapes + 2], ids), "", ""};
+                for (int i = 0; i < tapes; ++i) {
+                    const std::string &read = w[1 + i], &write = w[tapes + 3 + i], &move = w[2 * tapes + 3 + i];
+                    if (read.size() != 1 || write.size() != 1) {
+                        fail(lineNumber, "symbols must be single characters");
+                    } else if (move != "L" && move != "R" && move != "S") {
+                        fail(lineNumber, "moves must be L, R or S");
+                    } else {
+                        addSymbol(read[0]);
+                        addSymbol(write[0]);
+                        rule.reads += read[0];
+                        rule.writes += write[0];
+                        rule.moves += move[0];
+                    }
+                }
+                rules.push_back(rule);
+            } else {
+                fail(lineNumber, "expected tapes, input, start, accept, reject or a transition");
+            }
+        }
+        if (!loadError.empty()) return;
+        if (tapes == 0 || startName.empty() || acceptName.empty() || rejectName.empty()) {
+            fail(lineNumber, "tapes, start, accept and reject are all required");
+            return;
+        }
+        start = stateId(startName, ids);
+        accept = stateId(acceptName, ids);
+        reject = stateId(rejectName, ids);
+
+        combinations = 1;
+        for (int i = 0; i < tapes; ++i) {
+            weights[i] = combinations;
+            combinations *= static_cast<size_t>(symbolCount());
+        }
+        if (combinations * stateNames.size() > TABLE_MAX_CELLS) {
+            fail(lineNumber, "table has more than " + std::to_string(TABLE_MAX_CELLS) + " cells");
+            return;
+        }
+        table.assign(combinations * stateNames.size(), Transition{});
+
+        // Expand every rule over the symbols its wildcards match. Earlier
+        // rules win, so specific rules go before wildcard ones.
+        std::vector<unsigned char> under(tapes);
+        for (const Rule &rule : rules) {
+            for (size_t symbols = 0; symbols < combinations; ++symbols) {
+                bool matches = true;
+                for (int i = 0; i < tapes; ++i) {
+                    under[i] = static_cast<unsigned char>(symbols / weights[i] % symbolCount());
+                    if (rule.reads[i] != TABLE_ANY && codes[static_cast<unsigned char>(rule.reads[i])] != under[i]) {
+                        matches = false;
+                    }
+                }
+                Transition &t = table[static_cast<size_t>(rule.state) * combinations + symbols];
+                if (!matches || t.next != TABLE_NO_STATE) continue;
+
+                t.next = rule.next;
+                t.sweep = rule.next == rule.state;
+                bool moves = false;
+                for (int i = 0; i < tapes; ++i) {
+                    t.write[i] = rule.writes[i] == TABLE_ANY ? under[i]
+                                                             : codes[static_cast<unsigned char>(rule.writes[i])];
+                    t.move[i] = rule.moves[i] == 'L' ? -1 : rule.moves[i] == 'R' ? 1 : 0;
+                    if (t.move[i] == 0 && t.write[i] != under[i]) t.sweep = false;
+                    if (t.move[i] != 0) moves = true;
+                }
+                t.sweep = t.sweep && moves;
+            }
+        }
+    }
+};
+
+// The tapes of a running table machine, one symbol code per cell. Each tape
+// grows to the right as its head moves. Shared by TableMachine and by the
+// code tm_codegen generates from a machine file.
+class MachineTapes {
+public:
+    explicit MachineTapes(int tapeCount) : tapes(tapeCount), heads(tapeCount, 0) {}
+
+    int tapeCount() const { return static_cast<int>(tapes.size()); }
+
+    // clear every tape and write input on the first one, coding each
+    // character through codes (from TuringMachineTable::inputCode). Returns
+    // false if the input has a character with no code.
+    template<typename Codes>
+    bool load(const std::string &input, Codes codes) {
+        for (size_t i = 0; i < tapes.size(); ++i) {
+            tapes[i].assign(1, 0);
+            heads[i] = 0;
+        }
+        tapes[0].resize(input.size() + 1, 0);
+        for (size_t i = 0; i < input.size(); ++i) {
+            int code = codes(input[i]);
+            if (code < 0) return false;
+            tapes[0][i] = static_cast<unsigned char>(code);
+        }
+        return true;
+    }
+
+    // symbol code under head i
+    unsigned char read(int i) const { return tapes[i][heads[i]]; }
+
+    void write(int i, unsigned char code) { tapes[i][heads[i]] = code; }
+
+    void right(int i) {
+        if (++heads[i] == tapes[i].size()) tapes[i].push_back(0);
+    }
+
+    // returns false when the head is on cell 0 and falls off the tape
+    bool left(int i) {
+        if (heads[i] == 0) return false;
+        --heads[i];
+        return true;
+    }
+
+    // take the step (write, move) `repeat` times on every tape. Only a sweep
+    // may repeat more than once, and sweepLength keeps a repeated left move
+    // off cell 0, so a false return (a head fell off the tape) always means
+    // the first step did.
+    bool step(const unsigned char *write, const signed char *move, uint64_t repeat) {
+        for (size_t i = 0; i < tapes.size(); ++i) {
+            std::vector<unsigned char> &tape = tapes[i];
+            size_t &head = heads[i];
+            if (move[i] > 0) {
+                if (tape.size() < head + repeat + 1) tape.resize(std::max(head + repeat + 1, 2 * tape.size()), 0);
+                std::fill(tape.begin() + head, tape.begin() + head + repeat, write[i]);
+                head += repeat;
+            } else if (move[i] < 0) {
+                if (head < repeat) return false;
+                std::fill(tape.begin() + (head - repeat + 1), tape.begin() + head + 1, write[i]);
+                head -= repeat;
+            } else {
+                tape[head] = write[i];
+            }
+        }
+        return true;
+    }
+
+    // How many times in a row a sweep transition with these moves will be
+    // taken, at most `budget`. The runs under the moving heads are walked in
+    // lock step so the work is the length of the shortest one. Returns 0
+    // when it never stops: every moving head runs right over blanks forever.
+    uint64_t sweepLength(const signed char *move, uint64_t budget) const {
+        int moving[TABLE_MAX_TAPES];
+        unsigned char symbol[TABLE_MAX_TAPES];
+        int count = 0;
+        for (int i = 0; i < tapeCount(); ++i) {
+            if (move[i] == 0) continue;
+            moving[count] = i;
+            symbol[count++] = read(i);
+        }
+
+        uint64_t repeat = 0;
+        while (repeat < budget) {
+            bool pastEnd = true;
+            for (int m = 0; m < count; ++m) {
+                const std::vector<unsigned char> &tape = tapes[moving[m]];
+                const size_t head = heads[moving[m]];
+                if (move[moving[m]] > 0) {
+                    // past the end of the stored tape every cell is blank
+                    if (head + repeat >= tape.size()) {
+                        if (symbol[m] != 0) return std::max<uint64_t>(repeat, 1);
+                        continue;
+                    }
+                    if (tape[head + repeat] != symbol[m]) return std::max<uint64_t>(repeat, 1);
+                } else if (repeat >= head || tape[head - repeat] != symbol[m]) {
+                    // stops short of cell 0 so that moving off the tape is
+                    // taken as a normal step
+                    return std::max<uint64_t>(repeat, 1);
+                }
+                pastEnd = false;
+            }
+            if (pastEnd) return 0;
+            ++repeat;
+        }
+        return repeat;
+    }
+
+private:
+    std::vector<std::vector<unsigned char>> tapes;
+    std::vector<size_t> heads;
+};
+
+// Runs a TuringMachineTable.
+//
+// Steps whose transition is a sweep (it loops on its state, and tapes that
+// stay keep their symbol) are taken as a macro step: the number of times the
+// step repeats before some moving head leaves its run of equal symbols is
+// measured directly on the tapes, and all of them are applied at once. This
+// is exact, it only skips dispatching the same transition again and again,
+// and the step count still counts every step.
+class TableMachine {
+public:
+    explicit TableMachine(const TuringMachineTable &machine) : machine(machine), tapes(machine.tapeCount()) {}
+
+    // run on input (written on the first tape) for at most stepLimit steps
+    MachineResult run(const std::string &input, uint64_t stepLimit) {
+        if (!tapes.load(input, [this](char c) { return machine.inputCode(c); })) {
+            return {MachineVerdict::REJECT, 0};
+        }
+
+        const int tapeCount = machine.tapeCount();
+        int state = machine.startState();
+        uint64_t steps = 0;
+        while (true) {
+            if (state == machine.acceptState()) return {MachineVerdict::ACCEPT, steps};
+            if (state == machine.rejectState()) return {MachineVerdict::REJECT, steps};
+            if (steps >= stepLimit) return {MachineVerdict::STEP_LIMIT, steps};
+
+            size_t symbols = 0;
+            for (int i = 0; i < tapeCount; ++i) {
+                symbols += tapes.read(i) * machine.tapeWeight(i);
+            }
+            const TuringMachineTable::Transition &t = machine.transition(state, symbols);
+            if (t.next == TABLE_NO_STATE) return {MachineVerdict::REJECT, steps};
+
+            uint64_t repeat = 1;
+            if (t.sweep) {
+                repeat = tapes.sweepLength(t.move, stepLimit - steps);
+                if (repeat == 0) return {MachineVerdict::STEP_LIMIT, stepLimit};
+            }
+            if (!tapes.step(t.write, t.move, repeat)) return {MachineVerdict::REJECT, steps + 1};
+            steps += repeat;
+            state = t.next;
+        }
+    }
+
+private:
+    const TuringMachineTable &machine;
+    MachineTapes tapes;
+};
+
+#endif
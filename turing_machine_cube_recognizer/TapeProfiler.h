@@ -0,0 +1,231 @@
+#ifndef TM_TAPE_PROFILER_H
+#define TM_TAPE_PROFILER_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TuringMachineTape.h"
+
+// buckets of the head position histogram: 0, 1, 2-3, 4-7, ... 2^63-
+#define PROFILE_BUCKETS 65
+
+// magic at the start of a dumped trace, followed by the format version
+#define TRACE_MAGIC "TMTRACE"
+#define TRACE_VERSION 1
+
+// counts of what was done to one tape during a run
+struct TapeProfile {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t moves = 0;
+    uint64_t shifts = 0;
+    // most cells the tape has held, see TuringMachineTape::length
+    size_t peakLength = 0;
+    // where the head lands after each move, by power of two bucket
+    uint64_t headPositions[PROFILE_BUCKETS] = {};
+
+    static int bucket(uint64_t position) {
+#ifdef __GNUC__
+        return position ? 64 - __builtin_clzll(position) : 0;
+#else
+        int b = 0;
+        while (position) {
+            position >>= 1;
+            ++b;
+        }
+        return b;
+#endif
+    }
+
+    void print(std::ostream *out, const std::string &name) const {
+        *out << name << ": " << reads << " reads, " << writes << " writes, " << moves << " moves, "
+             << shifts << " shifts, peak length " << peakLength << std::endl;
+        for (int b = 0; b < PROFILE_BUCKETS; ++b) {
+            if (headPositions[b] == 0) continue;
+            uint64_t low = b == 0 ? 0 : uint64_t(1) << (b - 1);
+            *out << "  head at " << low << (b > 1 ? "+" : "") << ": " << headPositions[b] << std::endl;
+        }
+    }
+};
+
+enum class TraceOperation : uint8_t { READ, WRITE, LEFT, RIGHT, SHIFT, REJECT };
+
+// One traced tape operation. In a dump each record is packed into 10 bytes:
+// tape, operation, position (32 bit) and symbol (32 bit), little endian.
+struct TraceRecord {
+    uint8_t tape;
+    TraceOperation operation;
+    // head position before the operation, saturating at UINT32_MAX
+    uint32_t position;
+    // symbol read, written or inserted, 0 for moves
+    int32_t symbol;
+};
+
+// Ring buffer of the last `capacity` operations on any number of tapes, in
+// the order they happened. Older records are overwritten, so tracing a run
+// of any length costs a fixed amount of memory.
+class TapeTrace {
+public:
+    explicit TapeTrace(size_t capacity) : records(capacity > 0 ? capacity : 1) {}
+
+    void record(uint8_t tape, TraceOperation operation, size_t position, int symbol) {
+        TraceRecord &r = records[total++ % records.size()];
+        r.tape = tape;
+        r.operation = operation;
+        r.position = position > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(position);
+        r.symbol = symbol;
+    }
+
+    void clear() { total = 0; }
+
+    // operations recorded so far, including the ones overwritten
+    uint64_t recorded() const { return total; }
+
+    // write the records still in the buffer, oldest first: the magic, a
+    // version byte, the total recorded and the number kept (64 bit each),
+    // then the packed records
+    void dump(std::ostream *out) const {
+        uint64_t kept = total < records.size() ? total : records.size();
+        out->write(TRACE_MAGIC, sizeof(TRACE_MAGIC) - 1);
+        out->put(TRACE_VERSION);
+        writeInt(out, total, 8);
+        writeInt(out, kept, 8);
+        for (uint64_t i = total - kept; i < total; ++i) {
+            const TraceRecord &r = records[i % records.size()];
+            out->put(static_cast<char>(r.tape));
+            out->put(static_cast<char>(r.operation));
+            writeInt(out, r.position, 4);
+            writeInt(out, static_cast<uint32_t>(r.symbol), 4);
+        }
+    }
+
+    // read a dump back and print one line per record. Returns false if it
+    // is not a trace.
+    static bool render(std::istream *in, std::ostream *out) {
+        char magic[sizeof(TRACE_MAGIC) - 1];
+        in->read(magic, sizeof(magic));
+        if (!*in || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 || in->get() != TRACE_VERSION) return false;
+        uint64_t total = readInt(in, 8);
+        uint64_t kept = readInt(in, 8);
+        static const char *names[] = {"read", "write", "left", "right", "shift", "reject"};
+        for (uint64_t i = total - kept; i < total; ++i) {
+            int tape = in->get();
+            int operation = in->get();
+            uint64_t position = readInt(in, 4);
+            int32_t symbol = static_cast<int32_t>(readInt(in, 4));
+            if (!*in || operation > static_cast<int>(TraceOperation::REJECT)) return false;
+            *out << i << " tape " << tape << " " << names[operation] << " at " << position;
+            if (operation == static_cast<int>(TraceOperation::READ) || operation == static_cast<int>(TraceOperation::WRITE) ||
+                operation == static_cast<int>(TraceOperation::SHIFT)) {
+                *out << " " << TuringMachineTape::describe(symbol);
+            }
+            *out << '\n';
+        }
+        return true;
+    }
+
+private:
+    std::vector<TraceRecord> records;
+    uint64_t total = 0;
+
+    static void writeInt(std::ostream *out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            out->put(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    static uint64_t readInt(std::istream *in, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(in->get())) << (8 * i);
+        }
+        return value;
+    }
+};
+
+// Any tape with the TuringMachineTape interface, counting what is done to
+// it in a TapeProfile and, when given a TapeTrace, recording every
+// operation there. It is a separate type rather than a switch inside the
+// tapes, so runs that are not profiled pay nothing for it.
+template<typename Tape>
+class ProfiledTape {
+public:
+    // tape numbers this tape's records in a shared trace
+    explicit ProfiledTape(uint8_t id = 0, TapeTrace *trace = NULL) : id(id), trace(trace) {}
+
+    void reset(const std::string &input = "") {
+        tape.reset(input);
+        stats = TapeProfile();
+        head = 0;
+        stats.peakLength = tape.length();
+    }
+
+    int read() {
+        ++stats.reads;
+        int symbol = tape.read();
+        if (trace) trace->record(id, TraceOperation::READ, head, symbol);
+        return symbol;
+    }
+
+    void write(int symbol) {
+        ++stats.writes;
+        if (trace) trace->record(id, TraceOperation::WRITE, head, symbol);
+        tape.write(symbol);
+        grew();
+    }
+
+    void right() {
+        if (trace) trace->record(id, TraceOperation::RIGHT, head, 0);
+        tape.right();
+        moved(head + 1);
+    }
+
+    void left() {
+        if (trace) trace->record(id, TraceOperation::LEFT, head, 0);
+        tape.left();
+        if (head > 0) moved(head - 1);
+    }
+
+    void insert(int symbol) {
+        ++stats.shifts;
+        if (trace) trace->record(id, TraceOperation::SHIFT, head, symbol);
+        tape.insert(symbol);
+        if (symbol != BLANK_SYMBOL) ++head;
+        grew();
+    }
+
+    void reject() {
+        if (trace) trace->record(id, TraceOperation::REJECT, head, 0);
+        tape.reject();
+    }
+
+    bool rejected() const { return tape.rejected(); }
+    size_t length() const { return tape.length(); }
+    void debug(std::ostream *out=&std::cout) const { tape.debug(out); }
+
+    const TapeProfile &profile() const { return stats; }
+
+private:
+    Tape tape;
+    TapeProfile stats;
+    size_t head = 0;
+    uint8_t id;
+    TapeTrace *trace;
+
+    void moved(size_t position) {
+        head = position;
+        ++stats.moves;
+        ++stats.headPositions[TapeProfile::bucket(position)];
+        // moving only makes the tape longer by putting the head past its end
+        if (position + 1 > stats.peakLength) stats.peakLength = position + 1;
+    }
+
+    void grew() {
+        if (tape.length() > stats.peakLength) stats.peakLength = tape.length();
+    }
+};
+
+#endif
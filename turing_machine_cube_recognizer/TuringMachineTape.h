@@ -1,6 +1,8 @@
 #ifndef TM_TAPE_H
 #define TM_TAPE_H
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -11,45 +13,113 @@
 #define BEGIN_SYMBOL 1
 #define UTILITY_SYMBOL -9999
 
+// Cells are stored one byte each. Every tape numbers the symbols it sees
+// in order of first use and stores that number, with 0 standing for
+// BLANK_SYMBOL, so symbols outside a byte such as UTILITY_SYMBOL still fit;
+// a tape holds at most 255 different non-blank symbols, and one more
+// rejects it.
+//
+// The cells sit in the middle of a buffer with free space on both ends, so
+// an insert near the left end shifts the cells before the head left instead
+// of everything after it right, and insertBegin no longer moves the whole
+// tape. Cells past the last one written are blank and are not stored.
 class TuringMachineTape {
 public:
     // construct a tape with input read from the first line of the given
     // stream (or no input at all)
-    TuringMachineTape(std::istream *input=NULL) : tape(1, BLANK_SYMBOL) {
-        if (input) {
-            std::string line;
-            getline(*input, line);
-            tape.insert(tape.begin(), line.begin(), line.end());
+    TuringMachineTape(std::istream *input=NULL) {
+        symbols[0] = BLANK_SYMBOL;
+        std::string line;
+        if (input) getline(*input, line);
+        reset(line);
+    }
+
+    // start over with the given input, keeping the buffer (and the symbol
+    // codes) so a tape can be reused across runs without reallocating
+    void reset(const std::string &input = "") {
+        // cells past the end have to read as blank codes again
+        if (size > input.size()) memset(&cells[origin + input.size()], 0, size - input.size());
+        size = input.size();
+        reserveBack(size + MIN_SLACK);
+        blanks = 0;
+        for (size_t i = 0; i < size; ++i) {
+            cells[origin + i] = encode(input[i]);
+            if (cells[origin + i] == 0) ++blanks;
         }
         position = 0;
+        failed = false;
     }
 
     // return the symbol at the head
-    int read() const { return tape[position]; }
+    int read() const { return position < size ? symbols[cells[origin + position]] : BLANK_SYMBOL; }
 
     // write given symbol at the head
-    void write(int symbol) { if (symbol == BLANK_SYMBOL) reject(); tape[position] = symbol; }
+    void write(int symbol) {
+        if (symbol == BLANK_SYMBOL) return reject();
+        unsigned char code = encode(symbol);
+        if (code == 0) return;
+        if (position >= size) {
+            reserveBack(position + 1);
+            blanks += position - size;
+            size = position + 1;
+        } else if (cells[origin + position] == 0) {
+            --blanks;
+        }
+        cells[origin + position] = code;
+    }
 
     // move right / left
-    void right() { ++position; tape.resize(std::max(tape.size(), position + 1), BLANK_SYMBOL); }
-    void left() { if (position <= 0) reject(); --position; }
+    void right() { ++position; }
+    void left() { if (position <= 0) return reject(); --position; }
+
+    // open a space at the head by shifting everything up to the first blank
+    // right by one, write the given symbol there and move right onto the
+    // shifted cell
+    void insert(int symbol) {
+        if (symbol == BLANK_SYMBOL) return reject();
+        if (position >= size) {
+            write(symbol);
+            right();
+            return;
+        }
+
+        unsigned char code = encode(symbol);
+        if (code == 0) return;
+        unsigned char *head = &cells[origin + position];
+        void *blank = blanks > 0 ? memchr(head, 0, size - position) : NULL;
+        if (blank) {
+            // the shift stops at a blank inside the tape, filling it
+            memmove(head + 1, head, static_cast<unsigned char *>(blank) - head);
+            --blanks;
+        } else if (position < size - position) {
+            // everything after the head moves right, which is the same as
+            // the cells before it moving left
+            reserveFront(1);
+            --origin;
+            memmove(&cells[origin], &cells[origin + 1], position);
+            ++size;
+        } else {
+            reserveBack(size + 1);
+            head = &cells[origin + position];
+            memmove(head + 1, head, size - position);
+            ++size;
+        }
+        cells[origin + position] = code;
+        ++position;
+    }
 
     // dump the contents of the tape
     void debug(std::ostream *out=&std::cout) const {
+        size_t shown = std::max(size, position + 1);
         std::vector<size_t> widths;
-        for (auto i : tape) {
-            std::ostringstream term;
-            if (i >= 0 && isprint(i)) {
-                term << (char)i;
-            } else {
-                term << "<" << i << ">";
-            }
-            widths.push_back(term.str().length());
-            *out << "| " << term.str() << " ";
+        for (size_t i = 0; i < shown; ++i) {
+            std::string term = describe(i < size ? symbols[cells[origin + i]] : BLANK_SYMBOL);
+            widths.push_back(term.length());
+            *out << "| " << term << " ";
         }
         *out << "|" << std::endl;
 
-        for (size_t i = 0; i < tape.size(); ++i) {
+        for (size_t i = 0; i < shown; ++i) {
             *out << "| " << std::setw(widths[i]) << ((i == position) ? '^' : ' ') << " ";
         }
         *out << "|" << std::endl;
@@ -57,28 +127,104 @@ public:
         *out << '\n';
     }
 
-    // accept / reject special methods
-    static void accept() { std::cout << "accept" << std::endl; exit(0); }
-    static void reject() { std::cout << "reject" << std::endl; exit(0); }
+    // printable form of a symbol for debug output
+    static std::string describe(int symbol) {
+        std::ostringstream term;
+        if (symbol >= 0 && isprint(symbol)) {
+            term << (char)symbol;
+        } else {
+            term << "<" << symbol << ">";
+        }
+        return term.str();
+    }
+
+    // cells from cell 0 through the last one stored or the one under the
+    // head, whichever is further
+    size_t length() const { return std::max(size, position + 1); }
+
+    // Writing a blank or moving left off cell 0 rejects. The tape stays as it
+    // was and remembers that it rejected until the next reset, so the machine
+    // driving it checks rejected() instead of the process exiting.
+    void reject() { failed = true; }
+    bool rejected() const { return failed; }
 
 private:
-    std::vector<int> tape;
+    // free cells added on either end whenever one runs out, at least
+    static const size_t MIN_SLACK = 16;
+
+    // cells[origin + i] holds the code of cell i for i < size
+    std::vector<unsigned char> cells;
+    size_t origin = 0;
+    size_t size = 0;
+    // blank cells before `size`, left by writing past the end
+    size_t blanks = 0;
     size_t position;
+    bool failed = false;
+
+    // symbol for each code, and the code of each symbol in [-128, 255]
+    // (index symbol + 128) with 0 meaning not seen yet
+    int symbols[256];
+    unsigned char directCodes[384] = {};
+    std::vector<std::pair<int, unsigned char>> otherCodes;
+    int codeCount = 1;
+
+    unsigned char encode(int symbol) {
+        if (symbol == BLANK_SYMBOL) return 0;
+        unsigned char *code = NULL;
+        if (symbol >= -128 && symbol <= 255) {
+            code = &directCodes[symbol + 128];
+        } else {
+            for (auto &other : otherCodes) {
+                if (other.first == symbol) return other.second;
+            }
+            otherCodes.emplace_back(symbol, 0);
+            code = &otherCodes.back().second;
+        }
+        if (*code == 0) {
+            // out of codes: the tape is rejected and the symbol reads as blank
+            if (codeCount == 256) {
+                reject();
+                return 0;
+            }
+            symbols[codeCount] = symbol;
+            *code = static_cast<unsigned char>(codeCount++);
+        }
+        return *code;
+    }
+
+    // make room for n free cells before the first one
+    void reserveFront(size_t n) {
+        if (origin >= n) return;
+        size_t slack = std::max({n, size, MIN_SLACK});
+        std::vector<unsigned char> grown(slack + cells.size() - origin, 0);
+        memcpy(&grown[slack], cells.data() + origin, size);
+        cells.swap(grown);
+        origin = slack;
+    }
+
+    // make room for cells up to (but not including) logical index n
+    void reserveBack(size_t n) {
+        if (origin + n <= cells.size()) return;
+        cells.resize(origin + std::max({n, 2 * size, MIN_SLACK}), 0);
+    }
 };
 
 
 // Utility functions -- Use these and examine them to see how they work.
+// They work on any tape with the TuringMachineTape interface.
 class TuringMachineUtility {
 public:
     // seek to the left until we find the given symbol
-    static void findLeft(TuringMachineTape *t, int symbol) {
-        while (t->read() != symbol)
+    template<typename Tape>
+    static void findLeft(Tape *t, int symbol) {
+        while (t->read() != symbol && !t->rejected())
             t->left();
     }
 
     // seek to the right until we find the given symbol (or blank, causing
     // us to reject)
-    static void findRight(TuringMachineTape *t, int symbol) {
+    template<typename Tape>
+    static void findRight(Tape *t, int symbol) {
         while (t->read() != symbol && t->read() != BLANK_SYMBOL)
             t->right();
         if (t->read() != symbol)
@@ -86,30 +232,23 @@ public:
     }
 
     // go left, back to BEGIN_SYMBOL, then advance one
-    static void rewind(TuringMachineTape *t) {
+    template<typename Tape>
+    static void rewind(Tape *t) {
         findLeft(t, BEGIN_SYMBOL);
         t->right();
     }
 
     // open a space at the current head position by shifting everything to
-    // the right by one, then write the given symbol at that position.
-    static void shiftAndInsert(TuringMachineTape *t, int symbol) {
-        int saved = t->read();
-        t->write(UTILITY_SYMBOL);
-        while (saved != BLANK_SYMBOL) {
-            t->right();
-            int savedNext = t->read();
-            t->write(saved);
-            saved = savedNext;
-        }
-
-        findLeft(t, UTILITY_SYMBOL);
-        t->write(symbol);
-        t->right();
+    // the right by one, then write the given symbol at that position. How
+    // the shift is done is up to the tape.
+    template<typename Tape>
+    static void shiftAndInsert(Tape *t, int symbol) {
+        t->insert(symbol);
     }
 
     // insert the special BEGIN_SYMBOL at the current position of the head
-    static void insertBegin(TuringMachineTape *t) {
+    template<typename Tape>
+    static void insertBegin(Tape *t) {
         shiftAndInsert(t, BEGIN_SYMBOL);
     }
 };
@@ -0,0 +1,37 @@
+# Three tape version of the cube recognizer in main.cpp, over the input
+# alphabet {a}. Accepts a^n when n is a perfect cube (0 included).
+#
+# Tape 2 holds k y's for the round number k and tape 1 the k-th difference
+# of cubes, 3k^2 - 3k + 1 x's (1, 7, 19, 37, ...), which grows by 6k per
+# round. Each round consumes that many cells of the input on tape 0, so the
+# input runs out exactly at the end of a round when its length is a cube.
+tapes 3
+input a
+start init
+accept yes
+reject no
+
+init   _ _ _ -> yes     _ _ _   S S S
+init   * _ _ -> mark    * > >   S R R
+mark   * _ _ -> rewind  * x y   S L L
+
+# back to the first x and the first y
+rewind * x y -> rewind  * x y   S L L
+rewind * > y -> rewind  * > y   S S L
+rewind * x > -> rewind  * x >   S L S
+rewind * > > -> compare * > >   S R R
+
+# one input cell per x
+compare _ _ * -> yes    _ _ *   S S S
+compare _ x * -> no     _ x *   S S S
+compare * x * -> compare * x *  R R S
+compare * _ * -> grow0  * _ *   S S S
+
+# six more x's per y, then one more y
+grow0  * _ _ -> rewind  * _ y   S L L
+grow0  * _ y -> grow1   * x y   S R S
+grow1  * _ y -> grow2   * x y   S R S
+grow2  * _ y -> grow3   * x y   S R S
+grow3  * _ y -> grow4   * x y   S R S
+grow4  * _ y -> grow5   * x y   S R S
+grow5  * _ y -> grow0   * x y   S R R
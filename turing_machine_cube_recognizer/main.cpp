@@ -1,47 +1,273 @@
-#include "TuringMachineTape.h"
+#include "CubeOracle.h"
+#include "CubeRecognizer.h"
+#include "MachineBatch.h"
+#include "MachineResult.h"
+#include "TableMachine.h"
+#include "TapeProfiler.h"
+#include <chrono>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
-int main() {
-    TuringMachineTape input_tape{&std::cin};
-    TuringMachineUtility::insertBegin(&input_tape);
+#if __has_include("CubeMachine.h")
+// cube.tm compiled by tm_codegen, see CMakeLists.txt
+#include "CubeMachine.h"
+#define HAVE_CUBE_MACHINE 1
+#endif
 
-    TuringMachineTape count_tape{};
-    TuringMachineUtility::insertBegin(&count_tape);
-    count_tape.write('x');
+// load the machine in the given file, printing why if it cannot be used
+bool loadTable(const std::string &path, std::unique_ptr<TuringMachineTable> &table) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "cannot open " << path << std::endl;
+        return false;
+    }
+    table.reset(new TuringMachineTable(file));
+    if (!table->error().empty()) {
+        std::cerr << path << ": " << table->error() << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    TuringMachineTape incrementer_tape{};
-    TuringMachineUtility::insertBegin(&incrementer_tape);
+// run the built in recognizer on one input with its tapes profiled, print
+// the profile of each tape to stderr and dump the trace if asked to
+int runProfiled(const std::string &input, const std::string &tracePath, size_t traceSize) {
+    TapeTrace trace(tracePath.empty() ? 1 : traceSize);
+    TapeTrace *traced = tracePath.empty() ? NULL : &trace;
+    CubeRecognizer<ProfiledTape<TuringMachineTape>, ProfiledTape<RunLengthTape>> recognizer(
+            ProfiledTape<TuringMachineTape>(0, traced), ProfiledTape<RunLengthTape>(1, traced),
+            ProfiledTape<RunLengthTape>(2, traced));
 
-    while(true) {
-        while(incrementer_tape.read() != BLANK_SYMBOL) {
-            TuringMachineUtility::shiftAndInsert(&count_tape, 'x');
-            TuringMachineUtility::shiftAndInsert(&count_tape, 'x');
-            TuringMachineUtility::shiftAndInsert(&count_tape, 'x');
-            TuringMachineUtility::shiftAndInsert(&count_tape, 'x');
-            TuringMachineUtility::shiftAndInsert(&count_tape, 'x');
-            TuringMachineUtility::shiftAndInsert(&count_tape, 'x');
+    std::cout << verdictName(recognizer.run(input)) << std::endl;
+    recognizer.input().profile().print(&std::cerr, "input tape (0)");
+    recognizer.count().profile().print(&std::cerr, "count tape (1)");
+    recognizer.incrementer().profile().print(&std::cerr, "incrementer tape (2)");
 
-            incrementer_tape.right();
+    if (traced) {
+        std::ofstream out(tracePath, std::ios::binary);
+        trace.dump(&out);
+        if (!out) {
+            std::cerr << "cannot write " << tracePath << std::endl;
+            return 1;
         }
-        TuringMachineUtility::shiftAndInsert(&incrementer_tape, 'y');
-        TuringMachineUtility::rewind(&count_tape);
-        TuringMachineUtility::rewind(&incrementer_tape);
-
-        while(true) {
-            input_tape.right();
-            count_tape.right();
-            if (input_tape.read() == BLANK_SYMBOL && count_tape.read() != BLANK_SYMBOL) {
-                TuringMachineTape::reject();
-                return 0;
-            } else if (count_tape.read() == BLANK_SYMBOL && input_tape.read() != BLANK_SYMBOL) {
-                // through what needs done here, need to increment the count_tape
-                break;
-            } else if (count_tape.read() == BLANK_SYMBOL && input_tape.read() == BLANK_SYMBOL) {
-                // Both ended on BLANK_SYMBOL at the same time, so it is a cube
-                TuringMachineTape::accept();
-                return 0;
+        std::cerr << "traced " << trace.recorded() << " operations" << std::endl;
+    }
+    return 0;
+}
+
+// print a trace dumped by --trace as text
+int renderTrace(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "cannot open " << path << std::endl;
+        return 1;
+    }
+    if (!TapeTrace::render(&in, &std::cout)) {
+        std::cerr << path << ": not a trace" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Run every engine on the inputs a^0 .. a^maxLength and compare each with
+// cubeOracle. The table machine (when a machine file is given) and the
+// compiled one must also agree on step counts; the built in recognizer has
+// no steps of its own, so its count is the tape operations it does. Prints
+// one line per engine with its mismatches, total steps and time, and
+// returns 1 if any verdict or step count differs.
+int runDifferential(size_t maxLength, const TuringMachineTable *table, unsigned threads, uint64_t stepLimit) {
+    std::vector<std::string> inputs;
+    for (size_t n = 0; n <= maxLength; ++n) {
+        inputs.emplace_back(n, 'a');
+    }
+
+    struct Engine {
+        std::string name;
+        std::vector<MachineResult> results;
+        double seconds;
+    };
+    std::vector<Engine> engines;
+    auto run = [&](const std::string &name, auto makeRunner) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<MachineResult> results = runBatch(inputs, makeRunner, threads);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        engines.push_back({name, results, elapsed.count()});
+    };
+
+    run("oracle", []() {
+        return [](const std::string &input) { return MachineResult{cubeOracle(input), 0}; };
+    });
+    run("recognizer", []() {
+        return [recognizer = CubeRecognizer<ProfiledTape<TuringMachineTape>, ProfiledTape<RunLengthTape>>()](
+                const std::string &input) mutable {
+            MachineVerdict verdict = recognizer.run(input);
+            uint64_t operations = 0;
+            for (const TapeProfile *p : {&recognizer.input().profile(), &recognizer.count().profile(),
+                                         &recognizer.incrementer().profile()}) {
+                operations += p->reads + p->writes + p->moves + p->shifts;
+            }
+            return MachineResult{verdict, operations};
+        };
+    });
+    if (table) {
+        run("table", [table, stepLimit]() {
+            return [machine = TableMachine(*table), stepLimit](const std::string &input) mutable {
+                return machine.run(input, stepLimit);
+            };
+        });
+    }
+#ifdef HAVE_CUBE_MACHINE
+    run("compiled", [stepLimit]() {
+        return [stepLimit](const std::string &input) { return runCubeMachine(input, stepLimit); };
+    });
+#endif
+
+    const std::vector<MachineResult> &expected = engines[0].results;
+    const std::vector<MachineResult> *tableSteps = NULL;
+    bool failed = false;
+    std::cout << "inputs a^0 .. a^" << maxLength << std::endl;
+    for (const Engine &engine : engines) {
+        size_t mismatches = 0;
+        size_t stepMismatches = 0;
+        uint64_t steps = 0;
+        for (size_t n = 0; n < inputs.size(); ++n) {
+            steps += engine.results[n].steps;
+            if (engine.results[n].verdict != expected[n].verdict) {
+                if (mismatches++ < 10) {
+                    std::cerr << engine.name << ": a^" << n << " gives " << verdictName(engine.results[n].verdict)
+                              << ", expected " << verdictName(expected[n].verdict) << std::endl;
+                }
             }
+            if (tableSteps && engine.name == "compiled" && engine.results[n].steps != (*tableSteps)[n].steps) {
+                if (stepMismatches++ < 10) {
+                    std::cerr << engine.name << ": a^" << n << " takes " << engine.results[n].steps
+                              << " steps, the table machine " << (*tableSteps)[n].steps << std::endl;
+                }
+            }
+        }
+        if (engine.name == "table") tableSteps = &engine.results;
+        failed = failed || mismatches > 0 || stepMismatches > 0;
+
+        std::cout << engine.name << ": " << mismatches << " wrong verdicts";
+        if (stepMismatches > 0) std::cout << ", " << stepMismatches << " different step counts";
+        if (engine.name != "oracle") std::cout << ", " << steps << (engine.name == "recognizer" ? " tape operations" : " steps");
+        std::cout << ", " << engine.seconds << "s";
+        if (engine.name != "oracle" && engines[0].seconds > 0) {
+            std::cout << " (" << engine.seconds / engines[0].seconds << "x the oracle)";
+        }
+        std::cout << std::endl;
+    }
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    std::string machinePath;
+    bool compiled = false;
+    bool batch = false;
+    unsigned threads = 1;
+    bool profile = false;
+    std::string tracePath;
+    size_t traceSize = 1 << 20;
+    bool differential = false;
+    size_t differentialLength = 0;
+    uint64_t stepLimit = UINT64_MAX;
+    bool stepLimitGiven = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--machine" && i + 1 < argc) {
+            machinePath = argv[++i];
+        } else if (arg == "--steps" && i + 1 < argc) {
+            stepLimit = std::stoull(argv[++i]);
+            stepLimitGiven = true;
+        } else if (arg == "--compiled") {
+            compiled = true;
+        } else if (arg == "--batch") {
+            batch = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoul(argv[++i]);
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            profile = true;
+            tracePath = argv[++i];
+        } else if (arg == "--trace-size" && i + 1 < argc) {
+            traceSize = std::stoull(argv[++i]);
+        } else if (arg == "--render-trace" && i + 1 < argc) {
+            return renderTrace(argv[++i]);
+        } else if (arg == "--differential" && i + 1 < argc) {
+            differential = true;
+            differentialLength = std::stoull(argv[++i]);
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--machine machine_file | --compiled] [--steps limit] [--batch [--threads n]] < input\n"
+                      << "       " << argv[0] << " --profile [--trace file [--trace-size records]] < input\n"
+                      << "       " << argv[0] << " --render-trace file\n"
+                      << "       " << argv[0] << " --differential max_length [--machine machine_file] [--threads n]"
+                      << std::endl;
+            return 1;
         }
-        TuringMachineUtility::rewind(&count_tape);
     }
+    if (differential) {
+        std::unique_ptr<TuringMachineTable> table;
+        if (!machinePath.empty() && !loadTable(machinePath, table)) return 1;
+        return runDifferential(differentialLength, table.get(), threads, stepLimit);
+    }
+    // the built in recognizer counts no steps, so a limit would be ignored
+    if (stepLimitGiven && !compiled && machinePath.empty()) {
+        std::cerr << "--steps only works with --machine or --compiled" << std::endl;
+        return 1;
+    }
+    if (profile && (batch || compiled || !machinePath.empty())) {
+        std::cerr << "--profile and --trace only work on one input with the built in recognizer" << std::endl;
+        return 1;
+    }
+
+    // the first line of stdin is the input, or with --batch every line is
+    // one, each getting its own verdict line
+    std::vector<std::string> inputs;
+    std::string line;
+    while (getline(std::cin, line)) {
+        inputs.push_back(line);
+        if (!batch) break;
+    }
+    if (!batch && inputs.empty()) inputs.emplace_back();
+    if (profile) return runProfiled(inputs[0], tracePath, traceSize);
+
+    std::vector<MachineResult> results;
+    std::unique_ptr<TuringMachineTable> table;
+    if (compiled) {
+#ifdef HAVE_CUBE_MACHINE
+        results = runBatch(inputs, [stepLimit]() {
+            return [stepLimit](const std::string &input) { return runCubeMachine(input, stepLimit); };
+        }, threads);
+#else
+        std::cerr << "built without the compiled cube machine" << std::endl;
+        return 1;
+#endif
+    } else if (!machinePath.empty()) {
+        if (!loadTable(machinePath, table)) return 1;
+        results = runBatch(inputs, [&table, stepLimit]() {
+            return [machine = TableMachine(*table), stepLimit](const std::string &input) mutable {
+                return machine.run(input, stepLimit);
+            };
+        }, threads);
+    } else {
+        results = runBatch(inputs, []() {
+            return [recognizer = CubeRecognizer<>()](const std::string &input) mutable {
+                return MachineResult{recognizer.run(input), 0};
+            };
+        }, threads);
+    }
+
+    std::string out;
+    for (const MachineResult &result : results) {
+        out += verdictName(result.verdict);
+        out += '\n';
+    }
+    std::cout << out << std::flush;
+    return 0;
 }
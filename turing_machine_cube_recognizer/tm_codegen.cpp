@@ -0,0 +1,36 @@
+#include "MachineCompiler.h"
+#include "TableMachine.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// tm_codegen machine_file function_name output_header
+//
+// compiles a machine file into a header with one function running it, see
+// compileMachine
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        std::cerr << "usage: " << argv[0] << " machine_file function_name output_header" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(argv[1]);
+    if (!file) {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    TuringMachineTable table(file);
+    if (!table.error().empty()) {
+        std::cerr << argv[1] << ": " << table.error() << std::endl;
+        return 1;
+    }
+
+    std::ofstream out(argv[3]);
+    if (!out) {
+        std::cerr << "cannot write " << argv[3] << std::endl;
+        return 1;
+    }
+    std::string source = argv[1];
+    compileMachine(table, argv[2], source.substr(source.find_last_of('/') + 1), out);
+    return out ? 0 : 1;
+}